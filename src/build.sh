@@ -2,4 +2,4 @@
 
 set -xe
 
-cc -I include/ -o bless *.c
+cc -I include/ -o bless *.c -pthread
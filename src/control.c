@@ -1,11 +1,94 @@
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
 
 #include "control.h"
+#include "screen.h"
 #include "utils.h"
+#include "bless-config.h"
+
+static struct {
+    int fds[INPUT_MAX_WATCH];
+    size_t len;
+} g_watches = {0};
+
+// Background threads write to this to wake up get_user_input().
+static int g_wake_fds[2] = {-1, -1};
+
+void input_wake_init(void) {
+    if (pipe(g_wake_fds) == -1)
+        err("could not create the wake pipe");
+    for (int i = 0; i < 2; ++i)
+        fcntl(g_wake_fds[i], F_SETFL, fcntl(g_wake_fds[i], F_GETFL) | O_NONBLOCK);
+    input_watch(g_wake_fds[0]);
+}
+
+// Safe to call from any thread. If the pipe is full
+// a wake up is already pending so the write can be dropped.
+void input_wake(void) {
+    if (g_wake_fds[1] != -1) {
+        char b = 1;
+        (void)!write(g_wake_fds[1], &b, 1);
+    }
+}
+
+// Also wake up get_user_input() when `fd` becomes readable.
+void input_watch(int fd) {
+    if (g_watches.len >= INPUT_MAX_WATCH)
+        err_wargs("cannot watch more than %d inputs", INPUT_MAX_WATCH);
+    g_watches.fds[g_watches.len++] = fd;
+}
+
+void input_unwatch(int fd) {
+    for (size_t i = 0; i < g_watches.len; ++i) {
+        if (g_watches.fds[i] == fd) {
+            g_watches.fds[i] = g_watches.fds[--g_watches.len];
+            return;
+        }
+    }
+}
+
+// Blocks until a key is pressed (returns 1) or one
+// of the watched file descriptors is readable (returns 0).
+static int wait_for_key(void) {
+    if (g_watches.len == 0)
+        return 1;
+
+    struct pollfd pfds[1 + INPUT_MAX_WATCH];
+    pfds[0] = (struct pollfd) { .fd = g_tty_fd, .events = POLLIN };
+    for (size_t i = 0; i < g_watches.len; ++i)
+        pfds[i+1] = (struct pollfd) { .fd = g_watches.fds[i], .events = POLLIN };
+
+    while (poll(pfds, 1 + g_watches.len, -1) == -1)
+        if (errno != EINTR)
+            return 1;
+
+    if (pfds[0].revents != 0)
+        return 1;
+
+    char drain[64];
+    while (read(g_wake_fds[0], drain, sizeof(drain)) > 0)
+        ;
+    return 0;
+}
+
+// Whether a key has been pressed that has not been read yet,
+// without waiting for one.
+int input_pending(void) {
+    struct pollfd pfd = { .fd = g_tty_fd, .events = POLLIN };
+    return poll(&pfd, 1, 0) > 0;
+}
 
 User_Input_Type get_user_input(char *c) {
     assert(c);
     while (1) {
+        screen_present();
+        if (!wait_for_key()) {
+            *c = 0;
+            return USER_INPUT_TYPE_EVENT;
+        }
         *c = get_char();
         if (ESCSEQ(*c)) {
             int next0 = get_char();
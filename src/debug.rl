@@ -1,3 +1,3 @@
 module Debug
 
-$"gcc -o bless-debug-build *.c -O0 -ggdb -Iinclude/";
+$"gcc -o bless-debug-build *.c -O0 -ggdb -Iinclude/ -pthread";
@@ -0,0 +1,96 @@
+#include <regex.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+
+// The -f pattern, compiled once and then only read, so that
+// any number of threads can match against it at the same time.
+static struct {
+    regex_t re;
+    int enabled;
+    atomic_size_t lines, kept, ns;
+} g_filter;
+
+// Compiles `pattern` (a POSIX basic regex, like regex() in utils.c).
+// Returns 0 if it is not valid.
+int filter_init(const char *pattern) {
+    if (regcomp(&g_filter.re, pattern, REG_NOSUB) != 0)
+        return 0;
+    g_filter.enabled = 1;
+    return 1;
+}
+
+int filter_enabled(void) {
+    return g_filter.enabled;
+}
+
+// Whether the line `s` (without its newline) matches.
+int filter_keep(const char *s, size_t len) {
+    return filter_match(&g_filter.re, s, len);
+}
+
+// Runs `re` over `s` from byte `from` on (which does not count
+// as the start of the line), and fills in `match` (relative to `s`).
+// `s` does not have to be NUL-terminated.
+static int run(const regex_t *re, const char *s, size_t len, size_t from, regmatch_t *match) {
+    int flags = from > 0 ? REG_NOTBOL : 0;
+#ifdef REG_STARTEND
+    match->rm_so = (regoff_t)from;
+    match->rm_eo = (regoff_t)len;
+    return regexec(re, s, 1, match, flags | REG_STARTEND) == 0;
+#else
+    // regexec() needs a NUL-terminated string.
+    static _Thread_local char *tmp = NULL;
+    static _Thread_local size_t cap = 0;
+    if (len - from + 1 > cap) {
+        cap = len - from + 1;
+        tmp = realloc(tmp, cap);
+    }
+    memcpy(tmp, s + from, len - from);
+    tmp[len - from] = '\0';
+    if (regexec(re, tmp, 1, match, flags) != 0)
+        return 0;
+    match->rm_so += (regoff_t)from;
+    match->rm_eo += (regoff_t)from;
+    return 1;
+#endif
+}
+
+// Whether `re` matches anywhere in `s`.
+int filter_match(const regex_t *re, const char *s, size_t len) {
+    regmatch_t match;
+    return run(re, s, len, 0, &match);
+}
+
+// Where in `s` the first match of `re` starts, or -1. `re` has to
+// be compiled without REG_NOSUB.
+long filter_find(const regex_t *re, const char *s, size_t len) {
+    regmatch_t match;
+    return run(re, s, len, 0, &match) ? (long)match.rm_so : -1;
+}
+
+// Like filter_find(), but for the first match that starts at or
+// after `from`, and where it ends as well. Returns 0 if there is none.
+int filter_span(const regex_t *re, const char *s, size_t len, size_t from, size_t *start, size_t *end) {
+    regmatch_t match;
+    if (!run(re, s, len, from, &match))
+        return 0;
+    *start = (size_t)match.rm_so;
+    *end = (size_t)match.rm_eo;
+    return 1;
+}
+
+// Counts `lines` that were run through the filter in `ns`.
+void filter_account(size_t lines, size_t kept, size_t ns) {
+    atomic_fetch_add_explicit(&g_filter.lines, lines, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_filter.kept, kept, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_filter.ns, ns, memory_order_relaxed);
+}
+
+void filter_stats(size_t *lines, size_t *kept, size_t *ns) {
+    *lines = atomic_load_explicit(&g_filter.lines, memory_order_relaxed);
+    *kept = atomic_load_explicit(&g_filter.kept, memory_order_relaxed);
+    *ns = atomic_load_explicit(&g_filter.ns, memory_order_relaxed);
+}
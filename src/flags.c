@@ -1,4 +1,5 @@
-#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -15,13 +16,18 @@ void help(void) {
     printf("Bless Version: %s\n\n", VERSION);
 
     printf("Usage: bless [filepath...] [options...]\n");
+    printf("Use `-` as a filepath (or pipe into bless) to read from stdin\n");
     printf("Options:\n");
     printf("  %s,   -%c           Print this message\n", FLAG_2HY_HELP, FLAG_1HY_HELP);
     printf("  %s,   -%c           Just print the files (similar to `cat`)\n", FLAG_2HY_ONCE, FLAG_1HY_ONCE);
-    printf("  %s,  -%c           Show line numbers (unimplemented)\n", FLAG_2HY_LINES, FLAG_1HY_LINES);
+    printf("  %s,  -%c           Show line numbers\n", FLAG_2HY_LINES, FLAG_1HY_LINES);
     printf("  %s, -%c <regex>   Filter using regex\n", FLAG_2HY_FILTER, FLAG_1HY_FILTER);
     printf("  %s, -%c <editor>  Change the default editor\n", FLAG_2HY_EDITOR, FLAG_1HY_EDITOR);
+    printf("  %s, -%c    Ignore case when searching\n", FLAG_2HY_IGNORE_CASE, FLAG_1HY_IGNORE_CASE);
+    printf("  %s          Ignore case unless the search has an upper case letter\n", FLAG_2HY_SMART_CASE);
     printf("  %s   Do not jump to the column when searching\n", FLAG_2HY_NO_SEARCH_COL_JUMP);
+    printf("  %s              Follow files as they grow (like `tail -f`)\n", FLAG_2HY_FOLLOW);
+    printf("  %s <size>    Unload buffers not viewed in a while to stay under <size> (e.g. 512M, 2G)\n", FLAG_2HY_MEM_LIMIT);
     printf("\nValid editors are:\n");
     for (size_t i = 0; i < g_supported_editors_len; ++i)
         printf("    %s\n", g_supported_editors[i]);
@@ -41,6 +47,33 @@ void handle_editor_flag(int *argc, char ***argv) {
     g_editor = eat(argc, argv);
 }
 
+// Accepts a number of bytes with an optional K, M or G suffix.
+void handle_mem_limit_flag(int *argc, char ***argv) {
+    char *arg = eat(argc, argv);
+    if (!arg)
+        err_wargs("%s expects a size", FLAG_2HY_MEM_LIMIT);
+
+    char *end = NULL;
+    errno = 0;
+    unsigned long long n = strtoull(arg, &end, 10);
+    if (end == arg || *arg == '-' || errno == ERANGE)
+        err_wargs("invalid size: %s", arg);
+
+    size_t multiplier = 1;
+    switch (*end) {
+    case 'g': case 'G': multiplier *= 1024;  /* fallthrough */
+    case 'm': case 'M': multiplier *= 1024;  /* fallthrough */
+    case 'k': case 'K': multiplier *= 1024; ++end; break;
+    default: break;
+    }
+    if (*end != '\0' && strcmp(end, "B") && strcmp(end, "b"))
+        err_wargs("invalid size: %s", arg);
+    if (n > SIZE_MAX / multiplier)
+        err_wargs("invalid size: %s", arg);
+
+    g_mem_limit = (size_t)n * multiplier;
+}
+
 void handle_1hy_flag(const char *arg, int *argc, char ***argv) {
     const char *it = arg+1;
     while (it && *it != ' ' && *it != '\0') {
@@ -49,7 +82,7 @@ void handle_1hy_flag(const char *arg, int *argc, char ***argv) {
         else if (*it == FLAG_1HY_ONCE)
             g_flags |= FLAG_TYPE_ONCE;
         else if (*it == FLAG_1HY_LINES)
-            assert(0 && "unimplemented");
+            g_flags |= FLAG_TYPE_LINES;
         else if (*it == FLAG_1HY_FILTER) {
             g_flags |= FLAG_TYPE_FILTER;
             handle_filter_flag(argc, argv);
@@ -58,6 +91,8 @@ void handle_1hy_flag(const char *arg, int *argc, char ***argv) {
             g_flags |= FLAG_TYPE_EDITOR;
             handle_editor_flag(argc, argv);
         }
+        else if (*it == FLAG_1HY_IGNORE_CASE)
+            g_flags |= FLAG_TYPE_IGNORE_CASE;
         else if (*it == FLAG_1HY_VERSION) {
             g_flags |= FLAG_TYPE_VERSION;
             version();
@@ -74,7 +109,7 @@ void handle_2hy_flag(const char *arg, int *argc, char ***argv) {
     else if (!strcmp(arg, FLAG_2HY_ONCE))
         g_flags |= FLAG_TYPE_ONCE;
     else if (!strcmp(arg, FLAG_2HY_LINES))
-            assert(0 && "unimplemented");
+        g_flags |= FLAG_TYPE_LINES;
     else if (!strcmp(arg, FLAG_2HY_FILTER)) {
         g_flags |= FLAG_TYPE_FILTER;
         handle_filter_flag(argc, argv);
@@ -89,6 +124,16 @@ void handle_2hy_flag(const char *arg, int *argc, char ***argv) {
     }
     else if (!strcmp(arg, FLAG_2HY_NO_SEARCH_COL_JUMP))
         g_flags |= FLAG_TYPE_NO_SEARCH_COL_JUMP;
+    else if (!strcmp(arg, FLAG_2HY_FOLLOW))
+        g_flags |= FLAG_TYPE_FOLLOW;
+    else if (!strcmp(arg, FLAG_2HY_IGNORE_CASE))
+        g_flags |= FLAG_TYPE_IGNORE_CASE;
+    else if (!strcmp(arg, FLAG_2HY_SMART_CASE))
+        g_flags |= FLAG_TYPE_SMART_CASE;
+    else if (!strcmp(arg, FLAG_2HY_MEM_LIMIT)) {
+        g_flags |= FLAG_TYPE_MEM_LIMIT;
+        handle_mem_limit_flag(argc, argv);
+    }
     else
         err_wargs("Unknown option: `%s`", arg);
 }
@@ -0,0 +1,56 @@
+#include <libgen.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "follow.h"
+#include "control.h"
+
+static int g_inotify_fd = -1;
+
+// Returns 0 if the file cannot be watched.
+int follow_watch(const char *path, Follow_Watch *watch) {
+    watch->file = watch->dir = -1;
+
+    if (g_inotify_fd == -1) {
+        g_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (g_inotify_fd == -1)
+            return 0;
+        input_watch(g_inotify_fd);
+    }
+
+    watch->file = inotify_add_watch(g_inotify_fd, path,
+                                    IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF);
+    if (watch->file == -1)
+        return 0;
+
+    // dirname() may modify its argument.
+    char *copy = strdup(path);
+    watch->dir = inotify_add_watch(g_inotify_fd, dirname(copy), IN_CREATE | IN_MOVED_TO);
+    free(copy);
+
+    return 1;
+}
+
+// The directory watch is shared with every other buffer
+// in the same directory so it is left in place.
+void follow_unwatch(Follow_Watch *watch) {
+    if (g_inotify_fd != -1 && watch->file != -1)
+        inotify_rm_watch(g_inotify_fd, watch->file);
+    watch->file = watch->dir = -1;
+}
+
+// Throws away pending events. Returns whether there were
+// any, in which case every followed buffer should check
+// its file again.
+int follow_drain(void) {
+    if (g_inotify_fd == -1)
+        return 0;
+
+    char buf[4096];
+    int any = 0;
+    while (read(g_inotify_fd, buf, sizeof(buf)) > 0)
+        any = 1;
+    return any;
+}
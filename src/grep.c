@@ -0,0 +1,183 @@
+#include <stdarg.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "grep.h"
+#include "filter.h"
+#include "pool.h"
+#include "utils.h"
+
+typedef struct {
+    size_t line; // from the start of the chunk
+    size_t start, end;
+} Chunk_Hit;
+
+typedef struct {
+    const Grep_Source *source;
+    size_t index; // of `source`
+    size_t start, end;
+
+    // Filled in by the worker.
+    struct {
+        Chunk_Hit *data;
+        size_t len, cap;
+    } hits;
+    size_t lines;
+    int truncated;
+} Grep_Chunk;
+
+typedef struct {
+    const Search_Pattern *pattern;
+    Grep_Chunk *chunks;
+    atomic_size_t total;
+} Grep;
+
+typedef struct {
+    Grep *grep;
+    Grep_Chunk *chunk;
+} Chunk_Arg;
+
+typedef struct {
+    char *data;
+    size_t len, cap;
+} Text;
+
+static size_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec * 1000000000 + (size_t)ts.tv_nsec;
+}
+
+static int found_line(void *arg, size_t line, size_t start, size_t end) {
+    Chunk_Arg *a = (Chunk_Arg *)arg;
+    Grep_Chunk *chunk = a->chunk;
+    const char *data = chunk->source->data;
+
+    if (chunk->source->filtered && !filter_keep(data + start, end - start))
+        return 1;
+    if (atomic_fetch_add_explicit(&a->grep->total, 1, memory_order_relaxed) >= GREP_MAX_HITS) {
+        chunk->truncated = 1;
+        return 0;
+    }
+
+    da_append(chunk->hits.data, chunk->hits.len, chunk->hits.cap, Chunk_Hit *,
+              ((Chunk_Hit) { .line = line, .start = start, .end = end }));
+    return 1;
+}
+
+static void grep_chunk(void *arg, size_t i) {
+    Grep *grep = (Grep *)arg;
+    Chunk_Arg a = { .grep = grep, .chunk = &grep->chunks[i] };
+    a.chunk->lines = search_lines(grep->pattern, a.chunk->source->data, a.chunk->start, a.chunk->end, found_line, &a);
+}
+
+static void text_append(Text *text, const char *s, size_t len) {
+    if (text->len + len + 1 > text->cap) {
+        while (text->len + len + 1 > text->cap)
+            text->cap = text->cap ? text->cap * 2 : 4096;
+        text->data = (char *)realloc(text->data, text->cap);
+    }
+    memcpy(text->data + text->len, s, len);
+    text->len += len;
+    text->data[text->len] = '\0';
+}
+
+static void text_printf(Text *text, const char *format, ...) __attribute__((format(printf, 2, 3)));
+static void text_printf(Text *text, const char *format, ...) {
+    char tmp[1024];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(tmp, sizeof(tmp), format, args);
+    va_end(args);
+    if (len > 0)
+        text_append(text, tmp, (size_t)len < sizeof(tmp) ? (size_t)len : sizeof(tmp) - 1);
+}
+
+// Cuts `len` down to GREP_TEXT_MAX without splitting a character.
+static size_t shown_len(const char *s, size_t len) {
+    if (len <= GREP_TEXT_MAX)
+        return len;
+    len = GREP_TEXT_MAX;
+    while (len > 0 && ((unsigned char)s[len] & 0xC0) == 0x80)
+        --len;
+    return len;
+}
+
+// Searches every one of `sources` for `pattern` at the same time,
+// split into GREP_CHUNK pieces over the worker pool, and fills in
+// `hits` in order. Returns the text of the results buffer, with
+// hit `i` on the line that starts with `i`.
+char *grep_run(const Grep_Source *sources, size_t n, const Search_Pattern *pattern, Grep_Hits *hits) {
+    size_t start_ns = now_ns();
+    Grep grep = { .pattern = pattern };
+    atomic_init(&grep.total, 0);
+
+    // Chunks end on a newline so that a line is never split.
+    struct {
+        Grep_Chunk *data;
+        size_t len, cap;
+    } chunks = {0};
+    for (size_t i = 0; i < n; ++i) {
+        const Grep_Source *source = &sources[i];
+        for (size_t at = 0; at < source->len; ) {
+            size_t end = source->len;
+            if (end - at > GREP_CHUNK) {
+                const char *nl = memchr(source->data + at + GREP_CHUNK, '\n', source->len - at - GREP_CHUNK);
+                end = nl ? (size_t)(nl - source->data) + 1 : source->len;
+            }
+            da_append(chunks.data, chunks.len, chunks.cap, Grep_Chunk *,
+                      ((Grep_Chunk) { .source = source, .index = i, .start = at, .end = end }));
+            at = end;
+        }
+    }
+
+    grep.chunks = chunks.data;
+    pool_run(chunks.len, grep_chunk, &grep);
+
+    // Everything up to the first chunk that ran out of room is
+    // complete, later chunks may have been luckier and are dropped.
+    memset(hits, 0, sizeof(Grep_Hits));
+    size_t line = 0;
+    for (size_t i = 0; i < chunks.len && !hits->truncated; ++i) {
+        Grep_Chunk *chunk = &chunks.data[i];
+        if (i > 0 && chunk->index != chunks.data[i - 1].index)
+            line = 0;
+        for (size_t j = 0; j < chunk->hits.len; ++j)
+            da_append(hits->data, hits->len, hits->cap, Grep_Hit *,
+                      ((Grep_Hit) { .source = chunk->index, .line = line + chunk->hits.data[j].line }));
+        line += chunk->lines;
+        hits->truncated = chunk->truncated;
+    }
+    hits->ns = now_ns() - start_ns;
+
+    Text text = {0};
+    text_printf(&text, "=== Grep: %s ===\n", pattern->text);
+    text_printf(&text, "%zu matches in %zu buffers (%.1f ms)%s\n", hits->len, n, hits->ns / 1e6,
+                hits->truncated ? ", stopped at the limit" : "");
+    text_printf(&text, "Use :<number> to jump to a match\n");
+    text_printf(&text, "This buffer will not close upon selection\n\n");
+
+    // Written out again in order, since that is where the text is.
+    size_t k = 0;
+    for (size_t i = 0; i < chunks.len && k < hits->len; ++i) {
+        Grep_Chunk *chunk = &chunks.data[i];
+        const char *data = chunk->source->data;
+        for (size_t j = 0; j < chunk->hits.len && k < hits->len; ++j, ++k) {
+            const Chunk_Hit *hit = &chunk->hits.data[j];
+            text_printf(&text, "%-6zu %s:%zu: ", k, chunk->source->path, hits->data[k].line + 1);
+            size_t from = text.len;
+            text_append(&text, data + hit->start, shown_len(data + hit->start, hit->end - hit->start));
+            // The buffer is read up to the first NUL.
+            for (char *p = text.data + from; (p = memchr(p, '\0', text.len - (size_t)(p - text.data))); )
+                *p = ' ';
+            text_append(&text, "\n", 1);
+        }
+    }
+
+    for (size_t i = 0; i < chunks.len; ++i)
+        free(chunks.data[i].hits.data);
+    free(chunks.data);
+    return text.data;
+}
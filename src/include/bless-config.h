@@ -8,6 +8,9 @@ extern char *g_ob_fp;
 extern char *g_iu_fp;
 extern char *g_usage;
 extern char *g_qbuf_fp;
+extern char *g_stdin_fp;
+extern char *g_stats_fp;
+extern char *g_grep_fp;
 
 extern int g_win_width;
 extern int g_win_height;
@@ -16,6 +19,8 @@ extern uint32_t g_flags;
 extern char *g_filter_pattern;
 extern char *g_editor;
 extern struct termios g_old_termios;
+extern int g_tty_fd;
+extern size_t g_mem_limit;
 extern char *g_supported_editors[];
 extern size_t g_supported_editors_len;
 
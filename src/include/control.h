@@ -23,11 +23,11 @@
 #define RIGHT_ARROW   'C'
 #define LEFT_ARROW    'D'
 
-#define ENTER(ch)     (ch) == '\n'
-#define BACKSPACE(ch) (ch) == 8 || (ch) == 127
-#define ESCSEQ(ch)    (ch) == 27
-#define CSI(ch)       (ch) == '['
-#define TAB(ch)       (ch) == '\t'
+#define ENTER(ch)     ((ch) == '\n')
+#define BACKSPACE(ch) ((ch) == 8 || (ch) == 127)
+#define ESCSEQ(ch)    ((ch) == 27)
+#define CSI(ch)       ((ch) == '[')
+#define TAB(ch)       ((ch) == '\t')
 
 typedef enum {
     USER_INPUT_TYPE_CTRL,
@@ -36,8 +36,16 @@ typedef enum {
     USER_INPUT_TYPE_SHIFT_ARROW,
     USER_INPUT_TYPE_NORMAL,
     USER_INPUT_TYPE_UNKNOWN,
+    USER_INPUT_TYPE_EVENT, // A watched file descriptor is readable
 } User_Input_Type;
 
+#define INPUT_MAX_WATCH 64
+
 User_Input_Type get_user_input(char *c);
+void input_watch(int fd);
+void input_unwatch(int fd);
+void input_wake_init(void);
+void input_wake(void);
+int input_pending(void);
 
 #endif // CONTROL_H
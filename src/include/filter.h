@@ -0,0 +1,16 @@
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <regex.h>
+#include <stddef.h>
+
+int filter_init(const char *pattern);
+int filter_enabled(void);
+int filter_keep(const char *s, size_t len);
+int filter_match(const regex_t *re, const char *s, size_t len);
+long filter_find(const regex_t *re, const char *s, size_t len);
+int filter_span(const regex_t *re, const char *s, size_t len, size_t from, size_t *start, size_t *end);
+void filter_account(size_t lines, size_t kept, size_t ns);
+void filter_stats(size_t *lines, size_t *kept, size_t *ns);
+
+#endif // FILTER_H
@@ -7,6 +7,7 @@
 #define FLAG_1HY_FILTER  'f'
 #define FLAG_1HY_EDITOR  'e'
 #define FLAG_1HY_VERSION 'v'
+#define FLAG_1HY_IGNORE_CASE 'i'
 
 #define FLAG_2HY_HELP    "--help"
 #define FLAG_2HY_ONCE    "--once"
@@ -15,6 +16,10 @@
 #define FLAG_2HY_EDITOR  "--editor"
 #define FLAG_2HY_VERSION "--version"
 #define FLAG_2HY_NO_SEARCH_COL_JUMP "--no-search-col-jump"
+#define FLAG_2HY_FOLLOW  "--follow"
+#define FLAG_2HY_MEM_LIMIT "--mem-limit"
+#define FLAG_2HY_IGNORE_CASE "--ignore-case"
+#define FLAG_2HY_SMART_CASE "--smart-case"
 
 typedef enum {
     FLAG_TYPE_HELP    = 1 << 0,
@@ -24,6 +29,10 @@ typedef enum {
     FLAG_TYPE_EDITOR  = 1 << 4,
     FLAG_TYPE_VERSION = 1 << 5,
     FLAG_TYPE_NO_SEARCH_COL_JUMP = 1 << 6,
+    FLAG_TYPE_FOLLOW  = 1 << 7,
+    FLAG_TYPE_MEM_LIMIT = 1 << 8,
+    FLAG_TYPE_IGNORE_CASE = 1 << 9,
+    FLAG_TYPE_SMART_CASE = 1 << 10,
 } Flag_Type;
 
 void handle_1hy_flag(const char *arg, int *argc, char ***argv);
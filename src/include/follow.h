@@ -0,0 +1,15 @@
+#ifndef FOLLOW_H
+#define FOLLOW_H
+
+// inotify watches for buffers in follow mode (like `tail -f`).
+// The file itself is watched for writes, and its directory
+// for a new file showing up at the same path after a rotation.
+typedef struct {
+    int file, dir;
+} Follow_Watch;
+
+int follow_watch(const char *path, Follow_Watch *watch);
+void follow_unwatch(Follow_Watch *watch);
+int follow_drain(void);
+
+#endif // FOLLOW_H
@@ -0,0 +1,42 @@
+#ifndef GREP_H
+#define GREP_H
+
+#include <stddef.h>
+
+#include "search.h"
+
+// How much of a buffer one worker searches at a time.
+#define GREP_CHUNK (1024 * 1024)
+
+// Results past this many are dropped, so that grepping for
+// something that is on every line does not fill up memory.
+#define GREP_MAX_HITS 100000
+
+// How much of a matching line is shown.
+#define GREP_TEXT_MAX 256
+
+// One buffer to search. `data` has to stay put until grep_run()
+// returns, which the main thread makes sure of by not pumping
+// streams or following files in the meantime.
+typedef struct {
+    const char *path;
+    const char *data;
+    size_t len;
+    int filtered; // only lines matching -f are shown in it
+} Grep_Source;
+
+typedef struct {
+    size_t source; // into the sources given to grep_run()
+    size_t line;   // of the file, from 0
+} Grep_Hit;
+
+typedef struct {
+    Grep_Hit *data;
+    size_t len, cap;
+    int truncated; // stopped at GREP_MAX_HITS
+    size_t ns;
+} Grep_Hits;
+
+char *grep_run(const Grep_Source *sources, size_t n, const Search_Pattern *pattern, Grep_Hits *hits);
+
+#endif // GREP_H
@@ -2,9 +2,11 @@
 #define IO_H
 
 #include <stddef.h>
+#include <sys/stat.h>
 
 char *expand_tilde(const char *path);
 const char *file_to_cstr(const char *filename);
+const char *file_to_mmap(const char *filename, size_t *len, struct stat *st);
 const char *get_line_from_file_cstr(const char *fp, size_t lineno);
 int path_is_dir(const char *fp);
 char **walkdir(const char *dir_path, size_t *len);
@@ -0,0 +1,97 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "pool.h"
+
+// How often (in ms) the loader wakes the main thread to redraw progress.
+#define LINE_INDEX_WAKE_MS 100
+
+// A single line inside of `Matrix.data`. The
+// newline is not included in `len`. `ascii` and `utf8` are
+// worked out while indexing so that drawing a line does not
+// have to look at every byte to know how to decode it.
+typedef struct {
+    size_t off;
+    size_t len : 62;
+    size_t ascii : 1; // every byte is < 0x80
+    size_t utf8 : 1;  // the line is valid UTF-8
+} Line;
+
+// Where every line of a buffer begins and how long it is.
+//
+// It lives on the heap so that a loader job can keep filling
+// it while the Matrix it belongs to is copied around. There is only
+// ever one writer: either the loader or, lazily, the main thread.
+// The main thread can read `rows` published rows without locking
+// because `lines` is never freed while the loader is running, only
+// replaced by a bigger copy.
+typedef struct {
+    _Atomic(Line *) lines;
+    atomic_size_t rows;    // rows that are safe to read
+    atomic_size_t scanned; // bytes of `data` that have been indexed
+    atomic_int indexed;    // the whole of `data` has been indexed
+    int filtered;          // only lines matching -f are indexed
+
+    // Which line of `data` (from 0) each row is, only kept when
+    // `filtered` since otherwise that is the row itself. Grown and
+    // published along with `lines`.
+    _Atomic(size_t *) numbers;
+
+    // Writer only.
+    size_t written, cap;
+    size_t seen;      // lines of `data` scanned, kept or not
+    size_t dropped;   // bytes handed back with MADV_DONTNEED
+    size_t last_wake; // ms
+    struct {
+        void **data;
+        size_t len, cap;
+    } retired;
+
+    // The loader job on the worker pool, if there is one.
+    int loading;
+    Pool_Job job;
+    atomic_int cancel;
+    atomic_int done;
+    pthread_mutex_t lock;
+    pthread_cond_t grew;
+    const char *data;
+    size_t len;
+} Line_Index;
+
+Line_Index *line_index_create(int filtered);
+void line_index_free(Line_Index *index);
+void line_index_load(Line_Index *index, const char *data, size_t len);
+int line_index_has_row(Line_Index *index, const char *data, size_t len, size_t row, int live);
+int line_index_loading(Line_Index *index);
+int line_index_progress(Line_Index *index);
+void line_index_extend(Line_Index *index, const char *data, size_t old_len);
+
+static inline size_t line_index_rows(Line_Index *index) {
+    return atomic_load_explicit(&index->rows, memory_order_acquire);
+}
+
+static inline const Line *line_index_at(Line_Index *index, size_t row) {
+    return &atomic_load_explicit(&index->lines, memory_order_acquire)[row];
+}
+
+// The line of `data` (from 0) that `row` is.
+static inline size_t line_index_line(Line_Index *index, size_t row) {
+    if (!index->filtered)
+        return row;
+    return atomic_load_explicit(&index->numbers, memory_order_acquire)[row];
+}
+
+// The bytes taken up by the rows published so far.
+static inline size_t line_index_memory(Line_Index *index) {
+    return line_index_rows(index) * (sizeof(Line) + (index->filtered ? sizeof(size_t) : 0));
+}
+
+static inline int line_index_indexed(Line_Index *index) {
+    return atomic_load_explicit(&index->indexed, memory_order_acquire);
+}
+
+#endif // LINE_INDEX_H
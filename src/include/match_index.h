@@ -0,0 +1,51 @@
+#ifndef MATCH_INDEX_H
+#define MATCH_INDEX_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "pool.h"
+#include "search.h"
+
+// How much of the data the job searches before letting other jobs run.
+#define MATCH_INDEX_SLICE (16 * 1024 * 1024)
+
+// Every line of a buffer that the last search matches, found by a
+// job on the worker pool so that `n` and `N` only have to look the
+// next one up, and so that how many there are can be shown.
+//
+// It works on the bytes of the buffer and not on its Line_Index,
+// counting newlines as it goes, so it does not have to wait for the
+// loader and it knows the line in the file of every match even
+// with -f. `data` has to stay put until match_index_free().
+typedef struct {
+    Search_Pattern pattern;
+    const char *data;
+    size_t len;
+
+    // Shared with the main thread, under `lock`.
+    pthread_mutex_t lock;
+    pthread_cond_t finished_cond;
+    struct {
+        size_t *data; // lines (from 0) in order
+        size_t len, cap;
+    } lines;
+    size_t lines_done; // lines that have been searched
+    int complete;      // all of `data` has been searched
+    int finished;      // the job is done with this, cancelled or not
+    atomic_int cancel;
+
+    // Job only.
+    Pool_Job job;
+    size_t scanned;   // bytes
+    size_t line;      // the line `scanned` is at
+    size_t last_wake; // ms
+} Match_Index;
+
+Match_Index *match_index_create(const char *text, const char *data, size_t len);
+void match_index_free(Match_Index *matches);
+int match_index_next(Match_Index *matches, size_t line, int reverse, size_t *found);
+void match_index_position(Match_Index *matches, size_t line, size_t *k, size_t *total, int *complete);
+
+#endif // MATCH_INDEX_H
@@ -2,30 +2,164 @@
 #define MATRIX_H
 
 #include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
 
 #include "color.h"
 #include "dyn_array.h"
+#include "stream.h"
+#include "line_index.h"
+#include "follow.h"
+#include "view.h"
+#include "search.h"
+#include "match_index.h"
 
 #define CMD_SEQ_SEARCH "search"
 #define CMD_SEQ_SEARCHJMP "searchjmp"
 #define CMD_SEQ_QBUF "qbuf"
+#define CMD_SEQ_OPEN "open"
+#define CMD_SEQ_STATS "stats"
+#define CMD_SEQ_GREP "grep"
+#define CMD_SEQ_HL "hl"
+#define CMD_SEQ_UNHL "unhl"
 
+#define MATRIX_TAB_WIDTH 4
+
+// The smallest width of the -l line numbers, like `cat -n`.
+#define MATRIX_GUTTER_WIDTH 6
+
+// For long lines, the byte offset of the cell at every
+// MATRIX_COL_STEP'th column is remembered once the line has been
+// drawn. A window can then be cut out of the middle of it without
+// decoding everything in front of it again.
+#define MATRIX_COL_STEP 256
+#define MATRIX_COL_SLOTS 64
+
+// More than there are rows on screen, so that every row that is
+// drawn keeps its matches (see Span_Slot) from one frame to the next.
+#define MATRIX_SPAN_SLOTS 256
+
+// How matches of the last search are drawn.
+#define MATRIX_HIGHLIGHT INVERT
+
+typedef struct {
+    size_t byte, col;
+} Col_Mark;
+
+dyn_array_type(Col_Mark, Col_Marks);
+
+// Marks are only worked out as far as something has asked for.
+typedef struct {
+    int used;
+    size_t off, len;  // the Line the marks are for
+    size_t byte, col; // how far the line has been decoded
+    Col_Marks marks;
+} Col_Slot;
+
+// Where the pattern that is highlighted and the `:hl` terms match
+// in a line. Only as much of the line is searched as has been drawn,
+// so scrolling sideways or up and down over it again does not search
+// it again.
 typedef struct {
-    char *data;
-    size_t rows, cols;
+    size_t start, end; // bytes
+    int term;          // for `terms`
+} Match_Span;
+
+dyn_array_type(Match_Span, Match_Spans);
+
+typedef struct {
+    int used;
+    size_t off, len;   // the Line the spans are for
+
+    size_t gen;        // what was highlighted, see set_highlight()
+    size_t searched;   // every match that starts before this is in `spans`
+    Match_Spans spans;
+
+    // The terms do not overlap each other either, the one that starts
+    // first wins. Scanning leaves off in the middle of the automaton.
+    size_t terms_gen;
+    size_t terms_scanned;
+    int terms_state;
+    Match_Spans terms;
+} Span_Slot;
+
+// Keyed by where the line starts, so a line that gets
+// indexed again with a different length is noticed.
+typedef struct {
+    Col_Slot slots[MATRIX_COL_SLOTS];
+    Span_Slot spans[MATRIX_SPAN_SLOTS];
+} Col_Cache;
+
+// The raw bytes of a file are stored once in `data`
+// and `index` holds where every (unfiltered) line begins
+// and how long it is. Tabs and multi-byte characters are
+// expanded only when drawn (see `cols`), so memory scales with
+// the size of the file and not with the longest line.
+//
+// Files are mmap()'d and indexed by a loader thread in the
+// background, see line_index_load(). matrix_rows() is the number
+// of rows indexed *so far* and matrix_has_row() waits for the
+// loader to get to a row.
+//
+// Pipes and stdin are read into `stream` as data arrives and
+// `data`/`len` follow it. They (and internal buffers) are indexed
+// lazily on the main thread. A trailing line is only indexed once
+// its newline shows up (or the producer is done).
+//
+// Files named on the command line start out `lazy`, holding only
+// their path and what stat() said about them. They are read once
+// they are first viewed, see matrix_materialize(). Buffers that
+// have not been viewed in a while can be made lazy again to stay
+// under --mem-limit, see matrix_evict().
+//
+// In follow mode the file is watched with inotify and only the
+// bytes appended to it are indexed, see matrix_follow_update().
+//
+// With a `view` (see `&`), rows are the rows of the view and are
+// mapped to rows of `index` with matrix_source_row().
+typedef struct {
+    const char *data;
+    size_t len;
+    Line_Index *index;
+    Col_Cache *cols;
+    View *view;     // NULL unless filtered with `&`
+    Match_Index *matches; // of the last search, NULL until `n`/`N`
+    int mapped;     // `data` is mmap()'d
+    int lazy;       // Not read yet (or evicted), `data` is empty
+    int pinned;     // Keep the view at the bottom while rows are added
+    Stream *stream; // NULL unless reading from a pipe
+    int following;
+    Follow_Watch watch;
+    dev_t dev;             // What the file was when it was stat()'d,
+    ino_t ino;             // to notice it being rotated while following
+    struct timespec mtime; // or changed while evicted.
     char *filepath;
 } Matrix;
 
 typedef struct {
     Matrix m;
-    size_t lvl; // last viewed line
+    size_t lvl;    // last viewed line
+    size_t viewed; // when it was last switched to, for eviction
     const char *path;
 } Buffer;
 
 dyn_array_type(Buffer, Buffer_Array);
 
-#define MAT_AT(m, c, i, j) \
-    ((m)[(i) * (c) + (j)])
+static inline size_t matrix_source_row(const Matrix *const matrix, size_t row) {
+    return matrix->view ? matrix->view->rows.data[row] : row;
+}
+
+// The line of the file (from 0) that `row` is, through both
+// the `&` view and the -f filter.
+static inline size_t matrix_source_line(const Matrix *const matrix, size_t row) {
+    return line_index_line(matrix->index, matrix_source_row(matrix, row));
+}
+
+#define MATRIX_LINE_AT(m, i) \
+    (line_index_at((m)->index, matrix_source_row((m), (i))))
+
+#define MATRIX_LINE(m, i) \
+    ((m)->data + MATRIX_LINE_AT(m, i)->off)
 
 #define err_msg_wmatrix_wargs(matrix, line, column, msg, ...)   \
     do {                                                \
@@ -51,27 +185,57 @@ typedef enum {
     MATRIX_ACTION_SEARCH_FOUND = 1,
     MATRIX_ACTION_SEARCH_NOT_FOUND,
     MATRIX_ACTION_SEARCH_NO_PREV,
+    MATRIX_ACTION_SEARCH_INVALID_REGEX,
     MATRIX_ACTION_NOT_A_VALID_CMD_SEQ,
     MATRIX_ACTION_NO_QBUF_ENTRIES,
+    MATRIX_ACTION_COULD_NOT_OPEN,
+    MATRIX_ACTION_CANNOT_FOLLOW,
+    MATRIX_ACTION_NO_TERMS,
+    MATRIX_ACTION_TERM_FOUND,
+    MATRIX_ACTION_TERM_NOT_ADDED,
+    MATRIX_ACTION_LIST_TERMS,
 } Matrix_Action_Status;
 
 Matrix init_matrix(const char *src, char *filepath);
+Matrix init_matrix_from_file(char *filepath);
+Matrix init_matrix_from_stream(int fd, char *filepath);
+Matrix init_matrix_lazy(char *filepath);
+int matrix_materialize(Matrix *matrix);
+size_t matrix_resident(const Matrix *const matrix);
+int matrix_evictable(const Matrix *const matrix);
+void matrix_evict(Matrix *matrix);
+void free_matrix(Matrix *matrix);
+int matrix_has_row(Matrix *matrix, size_t row);
+size_t matrix_rows(const Matrix *const matrix);
+size_t matrix_index_all(Matrix *matrix);
+size_t matrix_row_of_line(Matrix *matrix, size_t line);
+int matrix_match_position(const Matrix *const matrix, size_t row, size_t *k, size_t *total, int *complete);
+int matrix_follow(Matrix *matrix, int on);
+int matrix_follow_update(Matrix *matrix, size_t *row);
+size_t matrix_line_width(const Matrix *const matrix, size_t row);
+size_t matrix_col_of(const Matrix *const matrix, size_t row, size_t byte);
+// Called with what has been typed so far whenever it changes.
+typedef void (*Mini_Buffer_Fn)(const char *input, void *arg);
+
 char *get_user_input_in_mini_buffer(char *prompt, char *last_input);
-void dump_matrix(const Matrix *const matrix, size_t start_row, size_t end_row, size_t start_col, size_t end_col);
-void handle_scroll_right(const Matrix *const matrix, size_t line, size_t *const column);
-void handle_scroll_left(const Matrix *const matrix, size_t line, size_t *const column);
-void handle_scroll_down(const Matrix *const matrix, size_t *const line, size_t column);
-void handle_scroll_up(const Matrix *const matrix, size_t *const line, size_t column);
-void handle_jump_to_top(const Matrix *const matrix, size_t *const line, size_t column);
-void handle_jump_to_bottom(const Matrix *const matrix, size_t *const line, size_t column);
-int find_word_in_matrix(Matrix *matrix, size_t start_row, size_t *column, char *word, size_t word_len, int reverse);
+char *get_user_input_in_mini_buffer_live(char *prompt, char *last_input, Mini_Buffer_Fn on_change, void *arg);
+void dump_matrix(Matrix *matrix, size_t start_row, size_t end_row, size_t start_col, size_t end_col);
+void handle_scroll_right(Matrix *matrix, size_t line, size_t *const column);
+void handle_scroll_left(Matrix *matrix, size_t line, size_t *const column);
+void handle_scroll_down(Matrix *matrix, size_t *const line, size_t column);
+void handle_scroll_up(Matrix *matrix, size_t *const line, size_t column);
+void handle_jump_to_top(Matrix *matrix, size_t *const line, size_t column);
+void handle_jump_to_bottom(Matrix *matrix, size_t *const line, size_t column);
+int find_word_in_matrix(Matrix *matrix, size_t start_row, size_t *column, const Search_Pattern *pattern, int reverse);
 Matrix_Action_Status handle_search(Matrix *matrix, size_t *line, size_t start_row, size_t *column, char *jump_to_next/*optional*/, int reverse);
 Matrix_Action_Status jump_to_last_searched_word(Matrix *matrix, size_t *line, size_t *column, int reverse);
+Matrix_Action_Status handle_jump_to_term(Matrix *matrix, size_t *line, size_t column, int reverse);
 void handle_page_up(Matrix *matrix, size_t *line, size_t column);
 void handle_page_down(Matrix *matrix, size_t *line, size_t column);
 void handle_jump_to_line_num(Matrix *matrix, size_t *line, size_t column, int user_input_line);
 void handle_jump_to_beginning_of_line(Matrix *matrix, size_t line, size_t *column);
 void handle_jump_to_end_of_line(Matrix *matrix, size_t line, size_t *column);
+void handle_filter_view(Matrix *matrix, size_t *line, size_t column);
 void redraw_matrix(Matrix *matrix, size_t line, size_t column);
 void display_tabs(Buffer_Array *buffers,
                   const Matrix *const matrix,
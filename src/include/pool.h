@@ -0,0 +1,30 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+typedef void (*Pool_Fn)(void *arg);
+typedef void (*Pool_Each_Fn)(void *arg, size_t i);
+
+// How many workers pool_run() asks for help at most.
+#define POOL_RUN_MAX_HELPERS 16
+
+// A unit of work for the worker pool. The memory belongs to
+// whoever submits it and must stay put until it has either run
+// or been taken back with pool_cancel(). Workers never touch a
+// job again after calling `fn`.
+typedef struct Pool_Job {
+    Pool_Fn fn;
+    void *arg;
+    struct Pool_Job *prev, *next;
+    int queued;
+} Pool_Job;
+
+void pool_init(size_t workers);
+size_t pool_workers(void);
+void pool_submit(Pool_Job *job, Pool_Fn fn, void *arg);
+int pool_bump(Pool_Job *job);
+int pool_cancel(Pool_Job *job);
+void pool_run(size_t n, Pool_Each_Fn fn, void *arg);
+
+#endif // POOL_H
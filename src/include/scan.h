@@ -0,0 +1,13 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include <stddef.h>
+
+const char *scan_line(const char *s, const char *end, int *ascii);
+int scan_utf8_valid(const char *s, size_t len);
+size_t scan_count_lines(const char *s, size_t len);
+const char *scan_impl(void);
+void scan_account(size_t bytes, size_t ns);
+void scan_stats(size_t *bytes, size_t *ns);
+
+#endif // SCAN_H
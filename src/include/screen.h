@@ -0,0 +1,52 @@
+#ifndef SCREEN_H
+#define SCREEN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The most bytes kept for one cell: a character and the
+// combining marks on it. Any more marks than fit are dropped.
+#define SCREEN_CELL_BYTES 16
+
+// How many unchanged cells are written again instead of moving the
+// cursor over them, which takes about that many bytes itself.
+#define SCREEN_SKIP_MIN 8
+
+// Colors are 0-255 (the first 16 are the usual ones), or this.
+#define SCREEN_DEFAULT_COLOR -1
+
+#define SCREEN_BOLD      (1 << 0)
+#define SCREEN_DIM       (1 << 1)
+#define SCREEN_ITALIC    (1 << 2)
+#define SCREEN_UNDERLINE (1 << 3)
+#define SCREEN_INVERT    (1 << 4)
+
+typedef struct {
+    int16_t fg, bg;
+    uint8_t effects;
+} Screen_Attr;
+
+typedef struct {
+    char bytes[SCREEN_CELL_BYTES];
+    uint8_t len;   // 0 for the right half of a wide character
+    uint8_t width;
+    Screen_Attr attr;
+} Screen_Cell;
+
+typedef struct {
+    size_t frames;
+    size_t bytes;         // written to the terminal in all
+    size_t writes;        // calls to write() that took
+    size_t last_bytes;    // by the last frame that changed anything
+    size_t scrolls;       // frames that scrolled the terminal
+    size_t scroll_bytes;  // written by the last one of those
+} Screen_Stats;
+
+void screen_init(int rows, int cols);
+void screen_end(void);
+void screen_present(void);
+void screen_invalidate(void);
+int screen_active(void);
+void screen_stats(Screen_Stats *stats);
+
+#endif // SCREEN_H
@@ -0,0 +1,44 @@
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <regex.h>
+#include <stddef.h>
+
+// What `/` looks for. Typing a `/` in front of it (so `//...`)
+// makes it a POSIX basic regex instead of plain text.
+typedef struct {
+    char *text; // as typed
+    int regex;
+    int fold; // ignores the case of ASCII letters, see search_folds()
+    regex_t re;
+
+    // Text that every match has: the whole pattern for plain text,
+    // and the longest run of it that a regex cannot do without (or
+    // NULL). Lines without it are skipped before regexec() runs.
+    // In lower case when `fold` is set.
+    char *needle;
+    size_t needle_len;
+} Search_Pattern;
+
+// See search_lines(). Returns 0 to stop.
+typedef int (*Search_Line_Fn)(void *arg, size_t line, size_t start, size_t end);
+
+int search_folds(const char *text);
+int search_pattern_init(Search_Pattern *pattern, const char *text);
+void search_pattern_free(Search_Pattern *pattern);
+const char *search_pattern_forward(const Search_Pattern *pattern, const char *s, size_t len);
+const char *search_pattern_backward(const Search_Pattern *pattern, const char *s, size_t len);
+long search_pattern_find(const Search_Pattern *pattern, const char *s, size_t len);
+
+size_t search_lines(const Search_Pattern *pattern, const char *data, size_t start, size_t end,
+                    Search_Line_Fn fn, void *arg);
+
+const char *search_forward(const char *s, size_t len, const char *needle, size_t n);
+const char *search_backward(const char *s, size_t len, const char *needle, size_t n);
+const char *search_forward_fold(const char *s, size_t len, const char *needle, size_t n);
+const char *search_backward_fold(const char *s, size_t len, const char *needle, size_t n);
+const char *search_impl(void);
+void search_account(size_t bytes, size_t ns);
+void search_stats(size_t *bytes, size_t *ns);
+
+#endif // SEARCH_H
@@ -0,0 +1,30 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+
+// Anything bigger than this is moved out of the heap and into
+// an unlinked temporary file that is mmap()'d instead.
+#define STREAM_SPILL_SIZE (64 * 1024 * 1024)
+
+// The most that is read in one call to stream_pump()
+// so that keystrokes are never starved by a fast producer.
+#define STREAM_PUMP_LIMIT (1024 * 1024)
+
+// Input that cannot be mmap()'d up front (pipes, stdin, FIFOs).
+// Bytes are appended to `data` as they arrive. `data` may move
+// after every call to stream_pump().
+typedef struct {
+    int fd;       // -1 once the producer is done
+    char *data;
+    size_t len, cap;
+    int spill_fd; // -1 until `data` has been spilled to disk
+} Stream;
+
+Stream *stream_open(int fd);
+size_t stream_pump(Stream *stream);
+void stream_pump_all(void);
+void stream_read_all(Stream *stream);
+void stream_free(Stream *stream);
+
+#endif // STREAM_H
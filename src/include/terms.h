@@ -0,0 +1,28 @@
+#ifndef TERMS_H
+#define TERMS_H
+
+#include <stddef.h>
+
+// How many highlight terms there can be at once, one for every color.
+#define TERMS_MAX 8
+
+// The longest a term can be.
+#define TERMS_TEXT_MAX 256
+
+// Called with the term that ends at byte `end` (exclusive) of what
+// is being scanned, the longest one if there are several. Returns 0
+// to stop.
+typedef int (*Terms_Fn)(void *arg, int term, size_t end);
+
+int terms_add(const char *text);
+int terms_remove(const char *text);
+void terms_clear(void);
+size_t terms_count(void);
+const char *terms_text(int term);
+size_t terms_len(int term);
+const char *terms_color(int term);
+size_t terms_longest(void);
+size_t terms_gen(void);
+size_t terms_scan(const char *s, size_t len, int *state, Terms_Fn fn, void *arg);
+
+#endif // TERMS_H
@@ -0,0 +1,10 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+size_t utf8_decode(const char *s, size_t len, uint32_t *cp);
+int utf8_width(uint32_t cp);
+
+#endif // UTF8_H
@@ -0,0 +1,67 @@
+#ifndef VIEW_H
+#define VIEW_H
+
+#include <regex.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "line_index.h"
+
+// Rows are matched and combined this many at a time, and a key
+// press is looked for in between while a view is `interruptible`.
+#define VIEW_BLOCK_ROWS 4096
+#define VIEW_BLOCK_WORDS (VIEW_BLOCK_ROWS / 64)
+
+// One pattern of a View. Bit `i` of `bits` is set if row `i` of the
+// Line_Index matches, whether the layer includes or `exclude`s
+// those rows, so it never has to be matched again when the layers
+// above or below it change.
+typedef struct {
+    char *pattern;
+    size_t pattern_len;
+    int exclude; // `&!`: keep the rows that do not match
+    int literal; // no special characters, matched with memmem()
+    regex_t re;
+
+    uint64_t *bits;
+    size_t words;   // allocated
+    size_t checked; // rows matched so far
+
+    // The layer this one replaced while its pattern was typed (see
+    // view_narrows()). Of its first `wider_checked` rows, only the
+    // ones set in `wider` can match.
+    uint64_t *wider;
+    size_t wider_checked;
+} View_Layer;
+
+// The rows of a buffer that match a stack of patterns (see `&`).
+// Only the row numbers are kept, never the lines themselves, and
+// rows are checked lazily as they are asked for, like the
+// Line_Index is.
+typedef struct {
+    struct {
+        View_Layer *data;
+        size_t len, cap;
+    } layers;
+
+    // Rows of the Line_Index that every layer lets through, in order.
+    struct {
+        size_t *data;
+        size_t len, cap;
+    } rows;
+    size_t checked; // rows of the Line_Index combined so far
+
+    int interruptible; // give up early when a key is pressed
+} View;
+
+View *view_create(void);
+void view_free(View *view);
+void view_reset(View *view);
+int view_push(View *view, const char *pattern);
+int view_replace_top(View *view, const char *pattern);
+void view_pop(View *view);
+size_t view_memory(const View *view);
+int view_has_row(View *view, Line_Index *index, const char *data, size_t len, size_t row, int live);
+void view_catch_up(View *view, Line_Index *index, const char *data);
+
+#endif // VIEW_H
@@ -2,7 +2,10 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "io.h"
 #include "utils.h"
@@ -105,6 +108,48 @@ const char *file_to_cstr(const char *filename) {
     return buffer;
 }
 
+// Maps the file read-only instead of reading it. Nothing is
+// read from disk until a page is touched. An empty file gives
+// back "" with a length of 0 as there is nothing to map. If `st`
+// is not NULL it is set to what the file that was mapped is.
+const char *file_to_mmap(const char *filename, size_t *len, struct stat *st) {
+    char *expanded_path = expand_tilde(filename);
+    if (!expanded_path) return NULL;
+
+    int fd = open(expanded_path, O_RDONLY);
+    free(expanded_path);
+
+    if (fd == -1) {
+        perror("Failed to open file");
+        return NULL;
+    }
+
+    struct stat fd_st;
+    if (fstat(fd, &fd_st) == -1) {
+        perror("Failed to stat file");
+        close(fd);
+        return NULL;
+    }
+    if (st)
+        *st = fd_st;
+
+    *len = (size_t)fd_st.st_size;
+    if (*len == 0) {
+        close(fd);
+        return "";
+    }
+
+    void *data = mmap(NULL, *len, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping stays valid after closing.
+
+    if (data == MAP_FAILED) {
+        perror("Failed to mmap file");
+        return NULL;
+    }
+
+    return (const char *)data;
+}
+
 const char *get_line_from_file_cstr(const char *fp, size_t lineno) {
     FILE *file = fopen(fp, "rb");
     if (!file) {
@@ -0,0 +1,391 @@
+#include <stdint.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "line_index.h"
+#include "control.h"
+#include "utils.h"
+#include "scan.h"
+#include "filter.h"
+
+// Anything the loader has scanned past is dropped from our
+// resident set every time this many bytes go by. The pages
+// stay in the page cache and fault back in when they are drawn.
+#define LINE_INDEX_DROP_BYTES (64 * 1024 * 1024)
+
+// How much the loader scans before handing rows to the main thread.
+#define LINE_INDEX_CHUNK (1024 * 1024)
+
+// How much the loader scans before letting other jobs on the pool run.
+#define LINE_INDEX_SLICE (16 * 1024 * 1024)
+
+static size_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec * 1000 + (size_t)ts.tv_nsec / 1000000;
+}
+
+// With `filtered`, only lines that match -f are indexed.
+Line_Index *line_index_create(int filtered) {
+    Line_Index *index = (Line_Index *)s_malloc(sizeof(Line_Index));
+    memset(index, 0, sizeof(Line_Index));
+    index->filtered = filtered && filter_enabled();
+    atomic_init(&index->lines, NULL);
+    atomic_init(&index->numbers, NULL);
+    atomic_init(&index->rows, 0);
+    atomic_init(&index->scanned, 0);
+    atomic_init(&index->indexed, 0);
+    atomic_init(&index->cancel, 0);
+    atomic_init(&index->done, 0);
+    pthread_mutex_init(&index->lock, NULL);
+    pthread_cond_init(&index->grew, NULL);
+    return index;
+}
+
+static void free_retired(Line_Index *index) {
+    for (size_t i = 0; i < index->retired.len; ++i)
+        free(index->retired.data[i]);
+    free(index->retired.data);
+    index->retired.data = NULL;
+    index->retired.len = index->retired.cap = 0;
+}
+
+// Forgets about the loader once it is done. Main thread only.
+static void reap(Line_Index *index) {
+    if (index->loading && atomic_load(&index->done)) {
+        index->loading = 0;
+        free_retired(index);
+    }
+}
+
+void line_index_free(Line_Index *index) {
+    if (index->loading) {
+        pthread_mutex_lock(&index->lock);
+        atomic_store(&index->cancel, 1);
+        pthread_mutex_unlock(&index->lock);
+        if (!pool_cancel(&index->job)) {
+            pthread_mutex_lock(&index->lock);
+            while (!atomic_load(&index->done))
+                pthread_cond_wait(&index->grew, &index->lock);
+            pthread_mutex_unlock(&index->lock);
+        }
+        index->loading = 0;
+    }
+    free_retired(index);
+    free(atomic_load(&index->lines));
+    free(atomic_load(&index->numbers));
+    pthread_mutex_destroy(&index->lock);
+    pthread_cond_destroy(&index->grew);
+    free(index);
+}
+
+// A copy of `old` with room for `cap` elements of `size`.
+static void *grow(Line_Index *index, void *old, size_t size, size_t cap) {
+    void *grown = s_malloc(cap * size);
+    if (old)
+        memcpy(grown, old, index->written * size);
+
+    // The main thread may still be reading the old table.
+    if (old && index->loading)
+        da_append(index->retired.data, index->retired.len, index->retired.cap, void **, old);
+    else
+        free(old);
+
+    return grown;
+}
+
+// Adds the row for `ln`, which is line `number` of the data.
+static void append(Line_Index *index, Line ln, size_t number) {
+    Line *lines = atomic_load_explicit(&index->lines, memory_order_relaxed);
+    size_t *numbers = atomic_load_explicit(&index->numbers, memory_order_relaxed);
+
+    if (index->written >= index->cap) {
+        size_t cap = index->cap ? index->cap * 2 : 1024;
+        lines = (Line *)grow(index, lines, sizeof(Line), cap);
+        atomic_store_explicit(&index->lines, lines, memory_order_release);
+        if (index->filtered) {
+            numbers = (size_t *)grow(index, numbers, sizeof(size_t), cap);
+            atomic_store_explicit(&index->numbers, numbers, memory_order_release);
+        }
+        index->cap = cap;
+    }
+
+    if (index->filtered)
+        numbers[index->written] = number;
+    lines[index->written++] = ln;
+}
+
+static void publish(Line_Index *index) {
+    pthread_mutex_lock(&index->lock);
+    atomic_store_explicit(&index->rows, index->written, memory_order_release);
+    pthread_cond_broadcast(&index->grew);
+    pthread_mutex_unlock(&index->lock);
+}
+
+static size_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec * 1000000000 + (size_t)ts.tv_nsec;
+}
+
+// The line from `off` up to `end` (its newline). Only lines
+// with multi-byte characters need validating.
+static Line make_line(const char *data, size_t off, size_t end, int ascii) {
+    int utf8 = ascii || scan_utf8_valid(data + off, end - off);
+    return (Line) { .off = off, .len = end - off, .ascii = ascii, .utf8 = utf8 };
+}
+
+// Indexes lines until `row` exists or the end of `data` is
+// reached. Only the bytes up to that line are touched. When
+// `live`, more data may still arrive so a trailing line without
+// a newline is left for later.
+static void scan(Line_Index *index, const char *data, size_t len, size_t row, int live) {
+    size_t start = atomic_load_explicit(&index->scanned, memory_order_relaxed), scanned = start;
+    size_t start_ns = now_ns(), lines = 0, kept = 0;
+
+    while (index->written <= row) {
+        if (scanned >= len) {
+            if (!live)
+                atomic_store_explicit(&index->indexed, 1, memory_order_release);
+            break;
+        }
+
+        int ascii;
+        const char *nl = scan_line(data + scanned, data + len, &ascii);
+        if (!nl && live)
+            break; // The rest of this line has not arrived yet.
+        size_t end = nl ? (size_t)(nl - data) : len;
+
+        ++lines;
+        if (!index->filtered || filter_keep(data + scanned, end - scanned)) {
+            append(index, make_line(data, scanned, end, ascii), index->seen);
+            ++kept;
+        }
+        ++index->seen;
+
+        // Handle the last line if it doesn't end with a newline
+        scanned = nl ? end + 1 : len;
+    }
+
+    atomic_store_explicit(&index->scanned, scanned, memory_order_relaxed);
+    publish(index);
+    if (index->filtered)
+        filter_account(lines, kept, now_ns() - start_ns);
+    else if (scanned > start)
+        scan_account(scanned - start, now_ns() - start_ns);
+}
+
+typedef struct {
+    const char *data;
+    size_t start, end; // both on a line boundary
+    size_t lines;
+    struct {
+        Line *data;
+        size_t len, cap;
+    } kept;
+    struct {
+        size_t *data; // which line of the chunk each kept line is
+        size_t len, cap;
+    } numbers;
+} Filter_Chunk;
+
+static void filter_chunk(void *arg, size_t i) {
+    Filter_Chunk *chunk = &((Filter_Chunk *)arg)[i];
+    const char *data = chunk->data;
+
+    for (size_t at = chunk->start; at < chunk->end; ) {
+        int ascii;
+        const char *nl = scan_line(data + at, data + chunk->end, &ascii);
+        size_t end = nl ? (size_t)(nl - data) : chunk->end;
+
+        if (filter_keep(data + at, end - at)) {
+            da_append(chunk->kept.data, chunk->kept.len, chunk->kept.cap, Line *, make_line(data, at, end, ascii));
+            da_append(chunk->numbers.data, chunk->numbers.len, chunk->numbers.cap, size_t *, chunk->lines);
+        }
+        ++chunk->lines;
+
+        at = nl ? end + 1 : chunk->end;
+    }
+}
+
+// Like scan() but for -f: indexes from where the loader is up to
+// about `until`, cut into chunks that end on a newline so that the
+// filter can be run over all of them on the pool at once. What
+// survives is appended in the order it appears in the file.
+static void filter_slice(Line_Index *index, size_t until) {
+    const char *data = index->data;
+    size_t len = index->len;
+    size_t start = atomic_load_explicit(&index->scanned, memory_order_relaxed);
+    size_t start_ns = now_ns();
+
+    struct {
+        Filter_Chunk *data;
+        size_t len, cap;
+    } chunks = {0};
+
+    for (size_t at = start; at < len && at < until; ) {
+        size_t end = len;
+        if (len - at > LINE_INDEX_CHUNK) {
+            const char *nl = memchr(data + at + LINE_INDEX_CHUNK, '\n', len - at - LINE_INDEX_CHUNK);
+            end = nl ? (size_t)(nl - data) + 1 : len;
+        }
+        da_append(chunks.data, chunks.len, chunks.cap, Filter_Chunk *,
+                  ((Filter_Chunk) { .data = data, .start = at, .end = end }));
+        at = end;
+    }
+
+    pool_run(chunks.len, filter_chunk, chunks.data);
+
+    size_t lines = 0, kept = 0, scanned = start;
+    for (size_t i = 0; i < chunks.len; ++i) {
+        Filter_Chunk *chunk = &chunks.data[i];
+        for (size_t j = 0; j < chunk->kept.len; ++j)
+            append(index, chunk->kept.data[j], index->seen + chunk->numbers.data[j]);
+        index->seen += chunk->lines;
+        lines += chunk->lines;
+        kept += chunk->kept.len;
+        scanned = chunk->end;
+        free(chunk->kept.data);
+        free(chunk->numbers.data);
+    }
+    free(chunks.data);
+
+    atomic_store_explicit(&index->scanned, scanned, memory_order_relaxed);
+    if (scanned >= len)
+        atomic_store_explicit(&index->indexed, 1, memory_order_release);
+    publish(index);
+    filter_account(lines, kept, now_ns() - start_ns);
+}
+
+static void loader(void *arg) {
+    Line_Index *index = (Line_Index *)arg;
+    size_t scanned = atomic_load_explicit(&index->scanned, memory_order_relaxed);
+    size_t slice_end = scanned + LINE_INDEX_SLICE;
+    size_t chunk = LINE_INDEX_CHUNK;
+
+    while (!line_index_indexed(index) && !atomic_load(&index->cancel) && scanned < slice_end) {
+        // Scanning a chunk at a time as if it were a stream that is
+        // still being written keeps a line from being split in two.
+        size_t before = scanned;
+        size_t upto = index->len - scanned > chunk ? scanned + chunk : index->len;
+        if (index->filtered)
+            filter_slice(index, slice_end);
+        else
+            scan(index, index->data, upto, SIZE_MAX, upto < index->len);
+
+        scanned = atomic_load_explicit(&index->scanned, memory_order_relaxed);
+
+        // A line longer than the chunk, try again with more of it.
+        if (scanned == before && upto < index->len)
+            chunk *= 2;
+        else
+            chunk = LINE_INDEX_CHUNK;
+
+        if (scanned - index->dropped >= LINE_INDEX_DROP_BYTES) {
+            size_t page = (size_t)sysconf(_SC_PAGESIZE);
+            size_t edge = scanned / page * page;
+            madvise((void *)(index->data + index->dropped), edge - index->dropped, MADV_DONTNEED);
+            index->dropped = edge;
+        }
+
+        if (now_ms() - index->last_wake >= LINE_INDEX_WAKE_MS) {
+            input_wake();
+            index->last_wake = now_ms();
+        }
+    }
+
+    pthread_mutex_lock(&index->lock);
+    if (!line_index_indexed(index) && !atomic_load(&index->cancel)) {
+        // Go to the back of the queue so that the other buffers get
+        // a turn. Done under the lock so line_index_free() either sees
+        // it queued or sees it finish.
+        pool_submit(&index->job, loader, index);
+        pthread_mutex_unlock(&index->lock);
+        return;
+    }
+    atomic_store(&index->done, 1);
+    pthread_cond_broadcast(&index->grew);
+    pthread_mutex_unlock(&index->lock);
+
+    // Nothing touches `index` after this, it may be freed right away.
+    // The main thread is woken last so that it sees the loader done.
+    input_wake();
+}
+
+// Indexes all of `data` on the worker pool, a slice at a time. Jobs
+// run in the order they were submitted so buffers become ready in
+// argument order, and one that is waited on jumps the queue.
+// `data` must stay mapped (and not move) until line_index_free().
+void line_index_load(Line_Index *index, const char *data, size_t len) {
+    index->data = data;
+    index->len = len;
+    index->loading = 1;
+    index->last_wake = now_ms();
+    pool_submit(&index->job, loader, index);
+}
+
+// Returns whether `row` exists. If the loader has not
+// gotten there yet this waits for it, otherwise the rows
+// are indexed right here. Main thread only.
+int line_index_has_row(Line_Index *index, const char *data, size_t len, size_t row, int live) {
+    if (row < line_index_rows(index))
+        return 1;
+
+    if (index->loading) {
+        // Someone is waiting on it now, don't let it sit in the queue.
+        (void)pool_bump(&index->job);
+
+        pthread_mutex_lock(&index->lock);
+        while (row >= line_index_rows(index) && !line_index_indexed(index) && !atomic_load(&index->done))
+            pthread_cond_wait(&index->grew, &index->lock);
+        pthread_mutex_unlock(&index->lock);
+        reap(index);
+    }
+    else if (!line_index_indexed(index))
+        scan(index, data, len, row, live);
+
+    return row < line_index_rows(index);
+}
+
+// Whether the loader is still running. Main thread only.
+int line_index_loading(Line_Index *index) {
+    reap(index);
+    return index->loading;
+}
+
+// How far along the loader is in percent, or -1 if there is no loader.
+int line_index_progress(Line_Index *index) {
+    reap(index);
+    if (!index->loading || index->len == 0)
+        return -1;
+    size_t scanned = atomic_load_explicit(&index->scanned, memory_order_relaxed);
+    return (int)(scanned * 100 / index->len);
+}
+
+// Data was appended after `old_len`, so the rest of it has to be
+// indexed too. If the old data ended without a newline, that last
+// line was cut short and is indexed again in full. Main thread
+// only, and not while loading.
+void line_index_extend(Line_Index *index, const char *data, size_t old_len) {
+    atomic_store_explicit(&index->indexed, 0, memory_order_release);
+
+    if (old_len == 0 || data[old_len-1] == '\n')
+        return;
+
+    size_t start = old_len;
+    while (start > 0 && data[start-1] != '\n')
+        --start;
+
+    size_t scanned = atomic_load_explicit(&index->scanned, memory_order_relaxed);
+    if (scanned <= start)
+        return; // Never got to it.
+
+    if (index->written > 0 && line_index_at(index, index->written-1)->off == start) {
+        --index->written;
+        publish(index);
+    }
+    --index->seen; // Whether it was kept or not.
+    atomic_store_explicit(&index->scanned, start, memory_order_relaxed);
+}
@@ -9,16 +9,27 @@
 #include <regex.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <limits.h>
 #include <sys/wait.h>
 #include <stdarg.h>
 #include <ctype.h>
+#include <fcntl.h>
 
 #include "dyn_array.h"
 #include "control.h"
 #include "flags.h"
 #include "io.h"
 #include "matrix.h"
+#include "stream.h"
+#include "follow.h"
+#include "pool.h"
+#include "scan.h"
+#include "filter.h"
+#include "search.h"
+#include "grep.h"
+#include "terms.h"
+#include "screen.h"
 #include "utils.h"
 #include "bless-config.h"
 
@@ -31,6 +42,9 @@
 char *g_ob_fp = "bless-open-buffer";
 char *g_iu_fp = "bless-usage";
 char *g_qbuf_fp = "Qbuf-buffer";
+char *g_stdin_fp = "-";
+char *g_stats_fp = "bless-stats";
+char *g_grep_fp = "Grep-buffer";
 char *g_usage = "Bless internal usage buffer:\n\n"
 "__________.__                        \n"
 "\\______   \\  |   ____   ______ ______\n"
@@ -51,6 +65,10 @@ char *g_usage = "Bless internal usage buffer:\n\n"
     "    :q              Quit buffer\n"
     "    :w              Save buffer\n"
     "    :qbuf           Query open buffer names with regex\n"
+    "    :grep <text>    Search every buffer, :grep /<regex> for a regex\n"
+    "    :hl <text>      Highlight text in its own color (:hl alone lists them)\n"
+    "    :unhl <text>    Stop highlighting text (:unhl alone for all of it)\n"
+    "    :stats          Show what each buffer has in memory\n"
     "    :<number>       Jump to line number\n\n"
 
     "Buffer Navigation\n"
@@ -88,15 +106,22 @@ char *g_usage = "Bless internal usage buffer:\n\n"
     "    0               Jump to beginning of line\n"
     "    C-a             Jump to beginning of line\n\n"
 
-    "    /               Enable search\n"
+    "    /               Enable search (start it with / for a regex)\n"
     "    C-s             Enable search\n\n"
 
+    "    &               Only show lines matching a pattern\n"
+    "    &!              Hide lines matching a pattern\n"
+    "    & (empty)       Remove the last filter\n\n"
+
     "Search Mode Commands\n"
     "    n               Next match\n\n"
 
     "    N               Previous match\n"
     "    p               Previous match\n\n"
 
+    "    ]               Next line with a :hl term\n"
+    "    [               Previous line with a :hl term\n\n"
+
     "Buffer Controls\n"
     "    q               Quit buffer\n"
     "    d               Quit buffer\n\n"
@@ -107,6 +132,7 @@ char *g_usage = "Bless internal usage buffer:\n\n"
     "    C-w             Save buffer\n"
     "    C-o             Open a saved buffer\n"
     "    C-q             Query open buffer names with regex\n"
+    "    F               Follow the file as it grows (like `tail -f`)\n"
     "    I               Open the current line in Vim\n"
     "    L               Redraw buffer\n"
     "    O               Open file in place\n\n"
@@ -130,6 +156,8 @@ uint32_t       g_flags          = 0x0;
 char          *g_filter_pattern = NULL;
 char          *g_editor         = "vim";
 struct termios g_old_termios;
+int            g_tty_fd         = STDIN_FILENO;
+size_t         g_mem_limit      = 0;
 char *g_supported_editors[] = {
     "vim",
     "nvim",
@@ -252,7 +280,8 @@ void remove_entry_from_config_file(int idx) {
 }
 
 void cleanup(void) {
-    tcsetattr(STDIN_FILENO, TCSANOW, &g_old_termios);
+    screen_end();
+    tcsetattr(g_tty_fd, TCSANOW, &g_old_termios);
 }
 
 void init_term(void) {
@@ -264,11 +293,19 @@ void init_term(void) {
         fprintf(stderr, "[Warning]: Could not get size of terminal. Undefined behavior may occur.");
     }
 
-    tcgetattr(STDIN_FILENO, &g_old_termios);
+    // When something is piped into us, stdin is the data
+    // and keys have to come from the terminal itself.
+    if (!isatty(STDIN_FILENO)) {
+        int fd = open("/dev/tty", O_RDONLY);
+        if (fd != -1)
+            g_tty_fd = fd;
+    }
+
+    tcgetattr(g_tty_fd, &g_old_termios);
     struct termios raw = g_old_termios;
     raw.c_lflag &= ~(ECHO | ICANON);
     raw.c_iflag &= ~IXON;
-    tcsetattr(STDIN_FILENO, TCSANOW, &raw);
+    tcsetattr(g_tty_fd, TCSANOW, &raw);
 }
 
 // Caller must free()
@@ -324,7 +361,9 @@ void parse_config_file(char ***paths,
 }
 
 void save_buffer(Matrix *matrix, size_t line, size_t column) {
-    if (!strcmp(matrix->filepath, g_ob_fp) || !strcmp(matrix->filepath, g_iu_fp)) {
+    if (!strcmp(matrix->filepath, g_ob_fp) || !strcmp(matrix->filepath, g_iu_fp)
+        || !strcmp(matrix->filepath, g_qbuf_fp) || !strcmp(matrix->filepath, g_grep_fp)
+        || !strcmp(matrix->filepath, g_stats_fp) || matrix->stream) {
         err_msg_wmatrix_wargs(matrix, line, column, "Canot save buffer `%s` as it is internal", matrix->filepath);
         return;
     }
@@ -361,8 +400,11 @@ void save_buffer(Matrix *matrix, size_t line, size_t column) {
         return;
     }
 
+    // The line in the file, in case it is opened without the same filters.
+    size_t file_line = matrix_has_row(matrix, line) ? matrix_source_line(matrix, line) : line;
+
     char text[512];
-    snprintf(text, sizeof(text), "%s:%zu:%s\n", fullpath, line, name);
+    snprintf(text, sizeof(text), "%s:%zu:%s\n", fullpath, file_line, name);
 
     if (fputs(text, file) == EOF) {
         perror("Error writing to file");
@@ -483,6 +525,127 @@ char *saved_buffer_contents_create(void) {
     return output;
 }
 
+// Formats `bytes` as something like 1.5M into `buf`.
+static const char *human_size(size_t bytes, char *buf, size_t cap) {
+    const char *units = "BKMGT";
+    double n = (double)bytes;
+    while (n >= 1024 && units[1]) {
+        n /= 1024;
+        ++units;
+    }
+    if (*units == 'B')
+        snprintf(buf, cap, "%zuB", bytes);
+    else
+        snprintf(buf, cap, "%.1f%c", n, *units);
+    return buf;
+}
+
+char *stats_buffer_create(Buffer_Array *buffers, int b_idx) {
+    char *output = calloc(1, 1);
+    size_t output_size = 0;
+    char a[32], b[32];
+
+    size_t total = 0;
+    for (size_t i = 0; i < buffers->len; ++i)
+        total += matrix_resident(&buffers->data[i].m);
+
+    append_str(&output, &output_size, "=== Stats ===\n");
+    append_str(&output, &output_size, "Resident: %s", human_size(total, a, sizeof(a)));
+    if (g_mem_limit)
+        append_str(&output, &output_size, " of %s (%s)\n", human_size(g_mem_limit, b, sizeof(b)), FLAG_2HY_MEM_LIMIT);
+    else
+        append_str(&output, &output_size, " (no %s)\n", FLAG_2HY_MEM_LIMIT);
+    size_t scanned, scan_ns;
+    scan_stats(&scanned, &scan_ns);
+    append_str(&output, &output_size, "Line scanner: %s", scan_impl());
+    if (scan_ns > 0)
+        append_str(&output, &output_size, ", indexed %s at %s/s",
+                   human_size(scanned, a, sizeof(a)),
+                   human_size((size_t)((double)scanned * 1e9 / (double)scan_ns), b, sizeof(b)));
+    append_str(&output, &output_size, "\n");
+    append_str(&output, &output_size, "Worker threads: %zu\n", pool_workers());
+    size_t searched, search_ns;
+    search_stats(&searched, &search_ns);
+    append_str(&output, &output_size, "Search: %s", search_impl());
+    if (BIT_SET(g_flags, FLAG_TYPE_IGNORE_CASE))
+        append_str(&output, &output_size, ", ignoring case (%s)", FLAG_2HY_IGNORE_CASE);
+    else if (BIT_SET(g_flags, FLAG_TYPE_SMART_CASE))
+        append_str(&output, &output_size, ", smart case (%s)", FLAG_2HY_SMART_CASE);
+    if (search_ns > 0)
+        append_str(&output, &output_size, ", last one went through %s at %s/s",
+                   human_size(searched, a, sizeof(a)),
+                   human_size((size_t)((double)searched * 1e9 / (double)search_ns), b, sizeof(b)));
+    append_str(&output, &output_size, "\n");
+    if (screen_active()) {
+        Screen_Stats screen;
+        screen_stats(&screen);
+        append_str(&output, &output_size, "Screen: %zu frames, %s written in %zu writes", screen.frames,
+                   human_size(screen.bytes, a, sizeof(a)), screen.writes);
+        if (screen.frames > 0)
+            append_str(&output, &output_size, " (%zu bytes per frame)", screen.bytes / screen.frames);
+        if (screen.scrolls > 0)
+            append_str(&output, &output_size, ", the last scroll took %zu bytes", screen.scroll_bytes);
+        append_str(&output, &output_size, "\n");
+    }
+    if (filter_enabled()) {
+        size_t lines, kept, ns;
+        filter_stats(&lines, &kept, &ns);
+        append_str(&output, &output_size, "Filter: %zu of %zu lines kept", kept, lines);
+        if (ns > 0)
+            append_str(&output, &output_size, ", %.0f lines/s", (double)lines * 1e9 / (double)ns);
+        append_str(&output, &output_size, "\n");
+    }
+    append_str(&output, &output_size, "\n");
+
+    append_str(&output, &output_size, "%-5s %-9s %-9s %-11s %-10s %s\n", "Index", "State", "Contents", "Line table", "Rows", "Path");
+    append_str(&output, &output_size, "----------------------------------------------------------------\n");
+
+    for (size_t i = 0; i < buffers->len; ++i) {
+        const Matrix *m = &buffers->data[i].m;
+        const char *state = (int)i == b_idx ? "viewing"
+            : m->lazy && m->index ? "evicted"
+            : m->lazy ? "unloaded"
+            : "resident";
+        size_t rows = m->index ? line_index_rows(m->index) : 0;
+
+        append_str(&output, &output_size, "%-5zu %-9s %-9s %-11s %-10zu %s\n",
+                   i, state,
+                   human_size(m->lazy ? 0 : m->len, a, sizeof(a)),
+                   human_size(m->index ? line_index_memory(m->index) : 0, b, sizeof(b)),
+                   rows, buffers->data[i].path);
+    }
+
+    return output;
+}
+
+// Evicts the least recently viewed buffers until all of them fit
+// in --mem-limit. The one being viewed is left alone.
+void enforce_mem_limit(Buffer_Array *buffers, int b_idx) {
+    if (!g_mem_limit)
+        return;
+
+    size_t total = 0;
+    for (size_t i = 0; i < buffers->len; ++i)
+        total += matrix_resident(&buffers->data[i].m);
+
+    while (total > g_mem_limit) {
+        Buffer *lru = NULL;
+        for (size_t i = 0; i < buffers->len; ++i) {
+            Buffer *b = &buffers->data[i];
+            if ((int)i == b_idx || !matrix_evictable(&b->m))
+                continue;
+            if (!lru || b->viewed < lru->viewed)
+                lru = b;
+        }
+        if (!lru)
+            break;
+
+        size_t before = matrix_resident(&lru->m);
+        matrix_evict(&lru->m);
+        total -= before - matrix_resident(&lru->m);
+    }
+}
+
 const char *get_matrix_path(Matrix *m) {
     return m->filepath;
 }
@@ -491,6 +654,7 @@ void push_buffer(Buffer_Array *buffers, Matrix *m) {
     Buffer b = (Buffer) {
         .m = *m,
         .lvl = 0,
+        .viewed = 0,
         .path = m->filepath,
     };
     dyn_array_append(*buffers, b);
@@ -499,9 +663,7 @@ void push_buffer(Buffer_Array *buffers, Matrix *m) {
 void delete_buffer(Buffer_Array *buffers, int *b_idx) {
     Matrix *m = &buffers->data[*b_idx].m;
 
-    if (strcmp(m->filepath, g_ob_fp) != 0
-        && strcmp(m->filepath, g_iu_fp) != 0)
-        free(m->data);
+    free_matrix(m);
 
     dyn_array_rm_at(*buffers, *b_idx);
 
@@ -509,6 +671,119 @@ void delete_buffer(Buffer_Array *buffers, int *b_idx) {
         --(*b_idx);
 }
 
+// What the Grep-buffer lists, so that :<number> can find the
+// buffer and line of a hit. Paths are copied since the buffers
+// may be closed in the meantime.
+static struct {
+    Grep_Hits hits;
+    char **paths;
+    size_t paths_len;
+} g_grep;
+
+static int is_internal_buffer(const Matrix *m) {
+    return !strcmp(m->filepath, g_ob_fp) || !strcmp(m->filepath, g_iu_fp)
+        || !strcmp(m->filepath, g_qbuf_fp) || !strcmp(m->filepath, g_stats_fp)
+        || !strcmp(m->filepath, g_grep_fp);
+}
+
+static void grep_forget(void) {
+    for (size_t i = 0; i < g_grep.paths_len; ++i)
+        free(g_grep.paths[i]);
+    free(g_grep.paths);
+    free(g_grep.hits.data);
+    memset(&g_grep, 0, sizeof(g_grep));
+}
+
+// Searches every open buffer for `text` (see Search_Pattern) and
+// returns what the Grep-buffer shows, or NULL with `status` set.
+// Buffers that have not been read yet are read first.
+char *grep_buffer_create(Buffer_Array *buffers, const char *text, int *status) {
+    Search_Pattern pattern;
+    if (!search_pattern_init(&pattern, text)) {
+        *status = MATRIX_ACTION_SEARCH_INVALID_REGEX;
+        return NULL;
+    }
+
+    // Files that have not been read (or were evicted) are only mapped
+    // while they are searched. They are not indexed and stay lazy, so
+    // that grepping does not load every buffer and go over --mem-limit.
+    dyn_arr(Grep_Source, sources);
+    dyn_arr(int, borrowed);
+    for (size_t i = 0; i < buffers->len; ++i) {
+        Matrix *m = &buffers->data[i].m;
+        if (is_internal_buffer(m))
+            continue;
+
+        Grep_Source source = { .path = m->filepath, .data = m->data, .len = m->len };
+        if (m->lazy) {
+            source.data = file_to_mmap(m->filepath, &source.len, NULL);
+            if (!source.data)
+                continue;
+            source.filtered = m->index ? m->index->filtered : filter_enabled();
+        }
+        else
+            source.filtered = m->index->filtered;
+
+        da_append(sources.data, sources.len, sources.cap, typeof(sources.data), source);
+        da_append(borrowed.data, borrowed.len, borrowed.cap, typeof(borrowed.data), m->lazy);
+    }
+
+    Grep_Hits hits;
+    char *contents = grep_run(sources.data, sources.len, &pattern, &hits);
+    search_pattern_free(&pattern);
+
+    for (size_t i = 0; i < sources.len; ++i)
+        if (borrowed.data[i] && sources.data[i].len > 0)
+            munmap((void *)sources.data[i].data, sources.data[i].len);
+    free(borrowed.data);
+
+    if (hits.len == 0) {
+        free(hits.data);
+        free(contents);
+        free(sources.data);
+        *status = MATRIX_ACTION_SEARCH_NOT_FOUND;
+        return NULL;
+    }
+
+    grep_forget();
+    g_grep.hits = hits;
+    g_grep.paths = s_malloc(sources.len * sizeof(char *));
+    for (size_t i = 0; i < sources.len; ++i)
+        g_grep.paths[i] = strdup(sources.data[i].path);
+    g_grep.paths_len = sources.len;
+
+    free(sources.data);
+    return contents;
+}
+
+// The buffer that hit `idx` of the last :grep is in, opening the
+// file again if it has been closed. Sets `row` to its line.
+int grep_hit_buffer(Buffer_Array *buffers, size_t idx, size_t *row) {
+    if (idx >= g_grep.hits.len)
+        return -1;
+    const Grep_Hit *hit = &g_grep.hits.data[idx];
+    const char *path = g_grep.paths[hit->source];
+
+    size_t b = 0;
+    while (b < buffers->len && strcmp(buffers->data[b].m.filepath, path))
+        ++b;
+    if (b == buffers->len) {
+        Matrix m = init_matrix_from_file(strdup(path));
+        if (!m.data)
+            return -1;
+        push_buffer(buffers, &m);
+    }
+
+    Matrix *m = &buffers->data[b].m;
+    if (!matrix_materialize(m))
+        return -1;
+    m->pinned = 0;
+    *row = matrix_row_of_line(m, hit->line);
+    if (!matrix_has_row(m, *row))
+        *row = matrix_rows(m) > 0 ? matrix_rows(m) - 1 : 0;
+    return (int)b;
+}
+
 int main(int argc, char **argv) {
     g_saved_buffers.paths = s_malloc(sizeof(char *));
     g_saved_buffers.len = 0, g_saved_buffers.cap = 1;
@@ -532,8 +807,18 @@ int main(int argc, char **argv) {
             dyn_array_append(paths, arg);
     }
 
+    if (BIT_SET(g_flags, FLAG_TYPE_FILTER) && !filter_init(g_filter_pattern))
+        err_wargs("invalid regex: %s", g_filter_pattern);
+
+    if (paths.len == 0 && !isatty(STDIN_FILENO))
+        dyn_array_append(paths, g_stdin_fp);
+
     atexit(cleanup);
     init_term();
+    input_wake_init();
+    pool_init(0);
+    if (!BIT_SET(g_flags, FLAG_TYPE_ONCE))
+        screen_init(g_win_height + 1, g_win_width + 1);
 
     if (BIT_SET(g_flags, FLAG_TYPE_EDITOR)) {
         int ok = 0;
@@ -552,7 +837,7 @@ int main(int argc, char **argv) {
 
     {size_t i = 0;
         while (i < paths.len) {
-            if (path_is_dir(paths.data[i])) {
+            if (path_is_dir(paths.data[i]) == 1) {
                 size_t files_len = 0;
                 char **files_in_dir = walkdir(paths.data[i], &files_len);
 
@@ -562,15 +847,15 @@ int main(int argc, char **argv) {
                 // Remove directory listing.
                 dyn_array_rm_at(paths, i);
             } else {
-                const char *fp = paths.data[i];
-                const char *src = file_to_cstr(fp);
+                // Not read until it is viewed, so that opening a lot
+                // of files does not wait on all of them.
+                Matrix matrix = init_matrix_lazy(paths.data[i]);
 
-                if (!src) {
+                if (!matrix.data) {
                     perror("src is NULL");
                     exit(EXIT_FAILURE);
                 }
 
-                Matrix matrix = init_matrix(src, paths.data[i]);
                 push_buffer(&buffers, &matrix);
                 ++i;
             }
@@ -581,28 +866,58 @@ int main(int argc, char **argv) {
         push_buffer(&buffers, &usage_matrix);
     }
 
+    if (BIT_SET(g_flags, FLAG_TYPE_FOLLOW) && !BIT_SET(g_flags, FLAG_TYPE_ONCE)) {
+        for (size_t i = 0; i < buffers.len; ++i) {
+            Matrix *m = &buffers.data[i].m;
+            if (matrix_follow(m, 1) || m->stream)
+                m->pinned = 1;
+        }
+    }
+
     int b_idx = 0;
+    size_t views = 0;
     while (1) {
         if (buffers.len == 0) {
             reset_scrn();
             goto end;
         }
 
-        Buffer *buffer = &buffers.data[b_idx];
-        Matrix *matrix = &buffer->m;
-
         if (BIT_SET(g_flags, FLAG_TYPE_ONCE)) {
             if (b_idx >= buffers.len)
                 break;
-            dump_matrix(matrix, 0, matrix->rows, 0, matrix->cols);
+            Matrix *matrix = &buffers.data[b_idx].m;
+            if (!matrix_materialize(matrix))
+                err_wargs("could not open %s", matrix->filepath);
+            // Have the next one loading while this one is written out.
+            if ((size_t)b_idx+1 < buffers.len)
+                (void)matrix_materialize(&buffers.data[b_idx+1].m);
+            if (matrix->stream)
+                stream_read_all(matrix->stream);
+            dump_matrix(matrix, 0, SIZE_MAX, 0, SIZE_MAX);
+            free_matrix(matrix);
             ++b_idx;
             continue;
         }
 
+        Buffer *buffer = &buffers.data[b_idx];
+        Matrix *matrix = &buffer->m;
+        int opened = matrix_materialize(matrix);
+        buffer->viewed = ++views;
+        enforce_mem_limit(&buffers, b_idx);
+
         size_t line = buffer->lvl, column = 0;
-        reset_scrn();
-        dump_matrix(matrix, line, g_win_height, column, g_win_width);
+        if (matrix->pinned)
+            handle_jump_to_bottom(matrix, &line, column);
+        else {
+            reset_scrn();
+            dump_matrix(matrix, line, g_win_height, column, g_win_width);
+        }
         display_tabs(&buffers, matrix, line, b_idx);
+        if (!opened) {
+            color(RED BOLD);
+            printf(":" CMD_SEQ_OPEN " [Could not open file]");
+            color(RESET);
+        }
 
         while (1) {
             if (buffers.len == 0) {
@@ -613,7 +928,33 @@ int main(int argc, char **argv) {
             char c;
             User_Input_Type ty = get_user_input(&c);
 
+            if (ty == USER_INPUT_TYPE_EVENT) {
+                // Only redraw if the new data can show up on screen,
+                // otherwise just update the progress in the tabs.
+                int was_full = line + g_win_height <= matrix_rows(matrix), changed = 0;
+                stream_pump_all();
+                (void)follow_drain();
+                for (size_t i = 0; i < buffers.len; ++i) {
+                    size_t *row = (int)i == b_idx ? &line : &buffers.data[i].lvl;
+                    if (matrix_follow_update(&buffers.data[i].m, row) && (int)i == b_idx)
+                        changed = 1;
+                }
+                if (matrix->pinned) {
+                    handle_jump_to_bottom(matrix, &line, column);
+                    display_tabs(&buffers, matrix, line, b_idx);
+                } else if (!was_full || changed) {
+                    reset_scrn();
+                    dump_matrix(matrix, line, g_win_height, column, g_win_width);
+                    display_tabs(&buffers, matrix, line, b_idx);
+                } else {
+                    clear_msg();
+                    display_tabs(&buffers, matrix, line, b_idx);
+                }
+                continue;
+            }
+
             clear_msg();
+            matrix->pinned = 0;
 
             int status = 0;
 
@@ -680,12 +1021,14 @@ int main(int argc, char **argv) {
                 else if (c == 'g') handle_jump_to_top(matrix, &line, column);
                 else if (c == 'G') handle_jump_to_bottom(matrix, &line, column);
                 else if (c == '/') status = handle_search(matrix, &line, line, &column, NULL, 0);
+                else if (c == '&') handle_filter_view(matrix, &line, column);
                 else if (c == '0') handle_jump_to_beginning_of_line(matrix, line, &column);
                 else if (c == '$') handle_jump_to_end_of_line(matrix, line, &column);
                 else if (c == ':') {
                     char *inp = get_user_input_in_mini_buffer(": ", NULL);
                     int is_open_buffer = !strcmp(matrix->filepath, g_ob_fp);
                     int is_qbuf_buffer = !strcmp(matrix->filepath, g_qbuf_fp);
+                    int is_grep_buffer = !strcmp(matrix->filepath, g_grep_fp);
                     if (!inp)
                         break;
                     else if (inp[0] == 'q' && !inp[1]) {
@@ -694,10 +1037,14 @@ int main(int argc, char **argv) {
                     }
                     else if (is_open_buffer && isdigit(inp[0])) {
                         int idx = atoi(inp);
-                        Matrix selected_matrix = init_matrix(file_to_cstr(g_saved_buffers.paths[idx]),
-                                                             g_saved_buffers.paths[idx]);
+                        Matrix selected_matrix = init_matrix_from_file(g_saved_buffers.paths[idx]);
+                        if (!selected_matrix.data) {
+                            status = MATRIX_ACTION_COULD_NOT_OPEN;
+                            break;
+                        }
+                        size_t lvl = matrix_row_of_line(&selected_matrix, g_saved_buffers.last_saved_lines[idx]);
                         push_buffer(&buffers, &selected_matrix);
-                        buffers.data[buffers.len - 1].lvl = g_saved_buffers.last_saved_lines[idx];
+                        buffers.data[buffers.len - 1].lvl = lvl;
                         delete_buffer(&buffers, &b_idx);
                         b_idx = buffers.len-1;
                         goto switch_buffer;
@@ -705,12 +1052,23 @@ int main(int argc, char **argv) {
                         int idx = atoi(inp);
                         b_idx = idx;
                         goto switch_buffer;
+                    } else if (is_grep_buffer && isdigit(inp[0])) {
+                        size_t row;
+                        int idx = grep_hit_buffer(&buffers, (size_t)atoi(inp), &row);
+                        if (idx < 0) {
+                            status = MATRIX_ACTION_COULD_NOT_OPEN;
+                            break;
+                        }
+                        buffers.data[b_idx].lvl = line;
+                        buffers.data[idx].lvl = row;
+                        b_idx = idx;
+                        goto switch_buffer;
                     } else if (isdigit(inp[0])) {
                         handle_jump_to_line_num(matrix, &line, column, atoi(inp));
                     } else if (is_open_buffer && inp[0] == 'r' && inp[1]) {
                         int idx = atoi(inp+1);
                         remove_entry_from_config_file(idx);
-                        free(matrix->data);
+                        free_matrix(matrix);
                         //delete_buffer(&buffers, &b_idx);
                         char *saved_buffer_contents = saved_buffer_contents_create();
                         *matrix = init_matrix(saved_buffer_contents, g_ob_fp);
@@ -721,6 +1079,48 @@ int main(int argc, char **argv) {
                         status = handle_search(matrix, &line, line, &column, NULL, 0);
                     else if (!strcmp(inp, "searchjmp"))
                         status = jump_to_last_searched_word(matrix, &line, &column, 0);
+                    else if (!strcmp(inp, CMD_SEQ_STATS)) {
+                        Matrix stats_matrix = init_matrix(stats_buffer_create(&buffers, b_idx), g_stats_fp);
+                        buffers.data[b_idx].lvl = line;
+                        push_buffer(&buffers, &stats_matrix);
+                        b_idx = buffers.len-1;
+                        goto switch_buffer;
+                    }
+                    else if (!strcmp(inp, CMD_SEQ_GREP) || !strncmp(inp, CMD_SEQ_GREP " ", strlen(CMD_SEQ_GREP) + 1)) {
+                        char *text = inp[strlen(CMD_SEQ_GREP)] ? inp + strlen(CMD_SEQ_GREP) + 1
+                            : get_user_input_in_mini_buffer("grep: ", NULL);
+                        if (!text || !*text)
+                            break;
+
+                        char *grep_contents = grep_buffer_create(&buffers, text, &status);
+                        if (!grep_contents)
+                            break;
+
+                        size_t i = 0;
+                        while (i < buffers.len && strcmp(buffers.data[i].m.filepath, g_grep_fp))
+                            ++i;
+                        buffers.data[b_idx].lvl = line;
+                        Matrix grep_matrix = init_matrix(grep_contents, g_grep_fp);
+                        if (i < buffers.len) {
+                            free_matrix(&buffers.data[i].m);
+                            buffers.data[i].m = grep_matrix;
+                            buffers.data[i].lvl = 0;
+                        } else {
+                            push_buffer(&buffers, &grep_matrix);
+                        }
+                        b_idx = (int)i;
+                        goto switch_buffer;
+                    }
+                    else if (!strcmp(inp, CMD_SEQ_HL))
+                        status = terms_count() ? MATRIX_ACTION_LIST_TERMS : MATRIX_ACTION_NO_TERMS;
+                    else if (!strncmp(inp, CMD_SEQ_HL " ", strlen(CMD_SEQ_HL) + 1)) {
+                        if (!terms_add(inp + strlen(CMD_SEQ_HL) + 1))
+                            status = MATRIX_ACTION_TERM_NOT_ADDED;
+                    }
+                    else if (!strcmp(inp, CMD_SEQ_UNHL))
+                        terms_clear();
+                    else if (!strncmp(inp, CMD_SEQ_UNHL " ", strlen(CMD_SEQ_UNHL) + 1))
+                        (void)terms_remove(inp + strlen(CMD_SEQ_UNHL) + 1);
                     else if (!strcmp(inp, "qbuf")) {
                         size_t one_idx = SIZE_MAX;
                         char *qbuf_contents = qbuf_buffer_create(&buffers, &one_idx);
@@ -743,6 +1143,17 @@ int main(int argc, char **argv) {
                 else if (c == 'n') status = jump_to_last_searched_word(matrix, &line, &column, 0);
                 else if (c == 'N'
                          || c == 'p') status = jump_to_last_searched_word(matrix, &line, &column, 1);
+                else if (c == ']') status = handle_jump_to_term(matrix, &line, column, 0);
+                else if (c == '[') status = handle_jump_to_term(matrix, &line, column, 1);
+                else if (c == 'F') {
+                    if (matrix->following)
+                        (void)matrix_follow(matrix, 0);
+                    else if (!matrix_follow(matrix, 1) && !matrix->stream) {
+                        status = MATRIX_ACTION_CANNOT_FOLLOW;
+                        break;
+                    }
+                    handle_jump_to_bottom(matrix, &line, column);
+                }
                 else if (c == 'I') launch_editor(matrix, line, column);
                 else if (c == 'L') redraw_matrix(matrix, line, column);
                 else if (c == 'z') handle_page_up(matrix, &line, column);
@@ -750,7 +1161,11 @@ int main(int argc, char **argv) {
                     char *new_filepath = get_user_input_in_mini_buffer("Path: ", NULL);
                     if (!new_filepath) break;
                     new_filepath = expand_tilde(new_filepath);
-                    Matrix new_matrix = init_matrix(file_to_cstr(new_filepath), new_filepath);
+                    Matrix new_matrix = init_matrix_from_file(new_filepath);
+                    if (!new_matrix.data) {
+                        status = MATRIX_ACTION_COULD_NOT_OPEN;
+                        break;
+                    }
                     push_buffer(&buffers, &new_matrix);
                     b_idx = buffers.len-1;
                     goto switch_buffer;
@@ -767,7 +1182,7 @@ int main(int argc, char **argv) {
                 }
                 else if (c == 'Q' || c == 'D') {
                     reset_scrn();
-                    free(matrix->data);
+                    free_matrix(matrix);
                     goto end;
                 }
                 else if (c == 'l') handle_scroll_right(matrix, line, &column);
@@ -787,29 +1202,60 @@ int main(int argc, char **argv) {
             }
 
             if (status == MATRIX_ACTION_SEARCH_FOUND) {
+                size_t k, total;
+                int complete;
                 color(BOLD GREEN);
                 printf(":" CMD_SEQ_SEARCHJMP " ([n] next) ([N] previous)");
+                if (matrix_match_position(matrix, line, &k, &total, &complete))
+                    printf(" match %zu/%zu%s", k, total, complete ? "" : "+");
+                color(RESET);
+            } else if (status == MATRIX_ACTION_TERM_FOUND) {
+                color(BOLD GREEN);
+                printf(":" CMD_SEQ_HL " (] next) ([ previous)");
+                color(RESET);
+            } else if (status == MATRIX_ACTION_LIST_TERMS) {
+                printf(":" CMD_SEQ_HL);
+                for (size_t i = 0; i < terms_count(); ++i) {
+                    putchar(' ');
+                    color(terms_color((int)i));
+                    printf("%s", terms_text((int)i));
+                    color(RESET);
+                }
+            } else if (status == MATRIX_ACTION_NO_TERMS) {
+                color(RED BOLD);
+                printf(":" CMD_SEQ_HL " [Nothing is highlighted]");
+                color(RESET);
+            } else if (status == MATRIX_ACTION_TERM_NOT_ADDED) {
+                color(RED BOLD);
+                printf(":" CMD_SEQ_HL " [Already highlighted, or %d terms already]", TERMS_MAX);
                 color(RESET);
-                fflush(stdout);
             } else if (status == MATRIX_ACTION_SEARCH_NOT_FOUND) {
                 color(RED BOLD);
                 printf(":" CMD_SEQ_SEARCH " [Search not found]");
-                fflush(stdout);
+                color(RESET);
+            } else if (status == MATRIX_ACTION_SEARCH_INVALID_REGEX) {
+                color(RED BOLD);
+                printf(":" CMD_SEQ_SEARCH " [Invalid regex]");
                 color(RESET);
             } else if (status == MATRIX_ACTION_SEARCH_NO_PREV) {
                 color(RED BOLD);
                 printf(":" CMD_SEQ_SEARCHJMP " [No previous search]");
-                fflush(stdout);
                 color(RESET);
             } else if (status == MATRIX_ACTION_NO_QBUF_ENTRIES) {
                 color(RED BOLD);
                 printf(":" CMD_SEQ_QBUF " [No buffers found]");
-                fflush(stdout);
+                color(RESET);
+            } else if (status == MATRIX_ACTION_CANNOT_FOLLOW) {
+                color(RED BOLD);
+                printf("[Cannot follow this buffer]");
+                color(RESET);
+            } else if (status == MATRIX_ACTION_COULD_NOT_OPEN) {
+                color(RED BOLD);
+                printf(":" CMD_SEQ_OPEN " [Could not open file]");
                 color(RESET);
             } else if (status == MATRIX_ACTION_NOT_A_VALID_CMD_SEQ) {
                 color(RED BOLD);
                 printf("[Not a command sequence]");
-                fflush(stdout);
                 color(RESET);
             } else {
                 reset_scrn();
@@ -0,0 +1,182 @@
+#include <string.h>
+#include <time.h>
+
+#include "match_index.h"
+#include "line_index.h"
+#include "control.h"
+#include "utils.h"
+
+// How much is searched before the matches are handed to the main thread.
+#define MATCH_INDEX_CHUNK (1024 * 1024)
+
+typedef struct {
+    size_t *data;
+    size_t len, cap;
+    size_t line; // of the start of the chunk
+} Found;
+
+static size_t now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec * 1000 + (size_t)ts.tv_nsec / 1000000;
+}
+
+static int found_line(void *arg, size_t line, size_t start, size_t end) {
+    (void)start, (void)end;
+    Found *found = (Found *)arg;
+    da_append(found->data, found->len, found->cap, size_t *, found->line + line);
+    return 1;
+}
+
+static void finish(Match_Index *matches) {
+    input_wake();
+
+    // Nothing touches `matches` after this, it may be freed right away.
+    pthread_mutex_lock(&matches->lock);
+    matches->finished = 1;
+    pthread_cond_broadcast(&matches->finished_cond);
+    pthread_mutex_unlock(&matches->lock);
+}
+
+static void job(void *arg) {
+    Match_Index *matches = (Match_Index *)arg;
+    size_t slice_end = matches->scanned + MATCH_INDEX_SLICE;
+    Found found = {0};
+
+    while (matches->scanned < matches->len && matches->scanned < slice_end && !atomic_load(&matches->cancel)) {
+        // Chunks end on a newline so that a line is never split.
+        size_t end = matches->len;
+        if (end - matches->scanned > MATCH_INDEX_CHUNK) {
+            size_t from = matches->scanned + MATCH_INDEX_CHUNK;
+            const char *nl = memchr(matches->data + from, '\n', matches->len - from);
+            end = nl ? (size_t)(nl - matches->data) + 1 : matches->len;
+        }
+
+        found.len = 0;
+        found.line = matches->line;
+        matches->line += search_lines(&matches->pattern, matches->data, matches->scanned, end, found_line, &found);
+        matches->scanned = end;
+
+        pthread_mutex_lock(&matches->lock);
+        for (size_t i = 0; i < found.len; ++i)
+            da_append(matches->lines.data, matches->lines.len, matches->lines.cap, size_t *, found.data[i]);
+        matches->lines_done = matches->line;
+        matches->complete = matches->scanned >= matches->len;
+        pthread_mutex_unlock(&matches->lock);
+
+        if (now_ms() - matches->last_wake >= LINE_INDEX_WAKE_MS) {
+            input_wake();
+            matches->last_wake = now_ms();
+        }
+    }
+    free(found.data);
+
+    pthread_mutex_lock(&matches->lock);
+    if (matches->scanned < matches->len && !atomic_load(&matches->cancel)) {
+        // Let the other jobs have a turn, like the loader does.
+        pool_submit(&matches->job, job, matches);
+        pthread_mutex_unlock(&matches->lock);
+        return;
+    }
+    matches->complete = 1;
+    pthread_mutex_unlock(&matches->lock);
+
+    finish(matches);
+}
+
+// Starts looking for every line of `data` that `text` (see
+// Search_Pattern) matches. Returns NULL if it is not a valid regex.
+Match_Index *match_index_create(const char *text, const char *data, size_t len) {
+    Match_Index *matches = (Match_Index *)s_malloc(sizeof(Match_Index));
+    memset(matches, 0, sizeof(Match_Index));
+    if (!search_pattern_init(&matches->pattern, text)) {
+        free(matches);
+        return NULL;
+    }
+
+    matches->data = data;
+    matches->len = len;
+    matches->last_wake = now_ms();
+    atomic_init(&matches->cancel, 0);
+    pthread_mutex_init(&matches->lock, NULL);
+    pthread_cond_init(&matches->finished_cond, NULL);
+    pool_submit(&matches->job, job, matches);
+    return matches;
+}
+
+// Stops the job (if it is still going) and frees everything.
+void match_index_free(Match_Index *matches) {
+    pthread_mutex_lock(&matches->lock);
+    atomic_store(&matches->cancel, 1);
+    pthread_mutex_unlock(&matches->lock);
+
+    if (!pool_cancel(&matches->job)) {
+        pthread_mutex_lock(&matches->lock);
+        while (!matches->finished)
+            pthread_cond_wait(&matches->finished_cond, &matches->lock);
+        pthread_mutex_unlock(&matches->lock);
+    }
+
+    search_pattern_free(&matches->pattern);
+    free(matches->lines.data);
+    pthread_mutex_destroy(&matches->lock);
+    pthread_cond_destroy(&matches->finished_cond);
+    free(matches);
+}
+
+// The first of `lines` that is greater than `line` (or
+// `len` if there is none).
+static size_t after(const size_t *lines, size_t len, size_t line) {
+    size_t lo = 0, hi = len;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (lines[mid] <= line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Sets `found` to the first match after `line` (or the last one
+// before it with `reverse`). Returns 1 if there is one, 0 if there
+// is none and -1 if that is not known until more has been searched.
+int match_index_next(Match_Index *matches, size_t line, int reverse, size_t *found) {
+    int result;
+    pthread_mutex_lock(&matches->lock);
+
+    if (!reverse) {
+        size_t i = after(matches->lines.data, matches->lines.len, line);
+        if (i < matches->lines.len) {
+            *found = matches->lines.data[i];
+            result = 1;
+        }
+        else
+            result = matches->complete ? 0 : -1;
+    }
+    else if (!matches->complete && line > matches->lines_done) {
+        result = -1; // There may be one in between.
+    }
+    else {
+        size_t i = after(matches->lines.data, matches->lines.len, line > 0 ? line - 1 : 0);
+        if (line > 0 && i > 0) {
+            *found = matches->lines.data[i - 1];
+            result = 1;
+        }
+        else
+            result = 0;
+    }
+
+    pthread_mutex_unlock(&matches->lock);
+    return result;
+}
+
+// How many matches there are up to and including `line` (`k`),
+// how many have been found in all and whether that is all of them.
+void match_index_position(Match_Index *matches, size_t line, size_t *k, size_t *total, int *complete) {
+    pthread_mutex_lock(&matches->lock);
+    *k = after(matches->lines.data, matches->lines.len, line);
+    *total = matches->lines.len;
+    *complete = matches->complete;
+    pthread_mutex_unlock(&matches->lock);
+}
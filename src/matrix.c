@@ -1,5 +1,11 @@
+#define _GNU_SOURCE // memrchr()
 #include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <string.h>
 #include <ctype.h>
@@ -10,122 +16,732 @@
 #include "bless-config.h"
 #include "utils.h"
 #include "flags.h"
+#include "utf8.h"
+#include "search.h"
+#include "filter.h"
+#include "terms.h"
+#include "pool.h"
+#include "screen.h"
+
+// How many rows a search looks at in one go, see find_word_forward().
+#define MATRIX_SEARCH_SPAN 65536
+
+// How much of the data one worker searches at a time, see find_chunked().
+#define MATRIX_SEARCH_CHUNK (1024 * 1024)
+
+// One thing drawn on screen: a character along with any combining
+// marks that follow it, a tab, or a byte that is not valid UTF-8.
+typedef struct {
+    size_t bytes; // taken up in the line
+    size_t width; // columns taken up on screen
+    char sub;     // if set, drawn in every column instead of the bytes
+} Cell;
+
+// Decodes the cell that starts at `s[i]`.
+static Cell next_cell(const char *s, size_t i, size_t len) {
+    if (s[i] == '\t')
+        return (Cell) { 1, MATRIX_TAB_WIDTH, ' ' };
+    if ((unsigned char)s[i] < 0x80)
+        return (Cell) { 1, 1, 0 };
+
+    uint32_t cp;
+    size_t n = utf8_decode(s + i, len - i, &cp);
+    int w = n ? utf8_width(cp) : -1;
+    if (w < 0)
+        return (Cell) { n ? n : 1, 1, '?' };
+
+    // Combining marks are drawn on top of the character before them.
+    Cell cell = { n, (size_t)w, 0 };
+    while (i + cell.bytes < len && (unsigned char)s[i + cell.bytes] >= 0x80) {
+        n = utf8_decode(s + i + cell.bytes, len - i - cell.bytes, &cp);
+        if (n == 0 || utf8_width(cp) != 0)
+            break;
+        cell.bytes += n;
+    }
+    return cell;
+}
+
+static Col_Cache *col_cache_create(void) {
+    Col_Cache *cols = (Col_Cache *)s_malloc(sizeof(Col_Cache));
+    memset(cols, 0, sizeof(Col_Cache));
+    return cols;
+}
+
+static void col_cache_free(Col_Cache *cols) {
+    for (size_t i = 0; i < MATRIX_COL_SLOTS; ++i)
+        if (cols->slots[i].used)
+            dyn_array_free(cols->slots[i].marks);
+    for (size_t i = 0; i < MATRIX_SPAN_SLOTS; ++i)
+        if (cols->spans[i].used)
+            dyn_array_free(cols->spans[i].spans);
+    free(cols);
+}
+
+// Returns the column marks of `row`, decoding it until either
+// column `col` or byte `byte` has been passed (or the line ends).
+// Lines that are no longer than a single step are cheap to decode
+// from the start and get none (NULL).
+static const Col_Slot *col_slot(const Matrix *const matrix, size_t row, size_t col, size_t byte) {
+    const Line *ln = MATRIX_LINE_AT(matrix, row);
+    if (!matrix->cols || ln->len <= MATRIX_COL_STEP)
+        return NULL;
+
+    size_t hash = (size_t)((ln->off * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+    Col_Slot *slot = &matrix->cols->slots[hash % MATRIX_COL_SLOTS];
+    if (!slot->used || slot->off != ln->off || slot->len != ln->len) {
+        if (!slot->used) {
+            dyn_array_init(slot->marks);
+            slot->used = 1;
+        }
+        dyn_array_clear(slot->marks);
+        slot->off = ln->off;
+        slot->len = ln->len;
+        slot->byte = slot->col = 0;
+    }
+
+    const char *s = matrix->data + ln->off;
+    size_t next = slot->marks.len == 0 ? 0
+        : (slot->marks.data[slot->marks.len-1].col / MATRIX_COL_STEP + 1) * MATRIX_COL_STEP;
+
+    while (slot->byte < ln->len && slot->col <= col && slot->byte <= byte) {
+        if (slot->col >= next) {
+            dyn_array_append(slot->marks, ((Col_Mark) { slot->byte, slot->col }));
+            next = (slot->col / MATRIX_COL_STEP + 1) * MATRIX_COL_STEP;
+        }
+        Cell cell = next_cell(s, slot->byte, ln->len);
+        slot->byte += cell.bytes;
+        slot->col += cell.width;
+    }
+
+    return slot;
+}
+
+// The last cell boundary of `row` at or before column `col`.
+static Col_Mark seek_col(const Matrix *const matrix, size_t row, size_t col) {
+    const Col_Slot *slot = col_slot(matrix, row, col, SIZE_MAX);
+    if (!slot || slot->marks.len == 0)
+        return (Col_Mark) { 0, 0 };
+
+    size_t lo = 0, hi = slot->marks.len;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slot->marks.data[mid].col <= col)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return slot->marks.data[lo];
+}
+
+// The last cell boundary of `row` at or before byte `byte`.
+static Col_Mark seek_byte(const Matrix *const matrix, size_t row, size_t byte) {
+    const Col_Slot *slot = col_slot(matrix, row, SIZE_MAX, byte);
+    if (!slot || slot->marks.len == 0)
+        return (Col_Mark) { 0, 0 };
+
+    size_t lo = 0, hi = slot->marks.len;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (slot->marks.data[mid].byte <= byte)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return slot->marks.data[lo];
+}
+
+// What is highlighted (NULL for nothing) and a number that changes
+// along with it, so spans found for something else are not used.
+static char *g_highlight = NULL;
+static size_t g_highlight_gen = 0;
+
+static const Search_Pattern *cached_pattern(const char *text);
+
+// Highlights every match of `text` (see Search_Pattern) when
+// drawing, or nothing with NULL.
+static void set_highlight(const char *text) {
+    if (g_highlight && text && !strcmp(g_highlight, text))
+        return;
+    if (!g_highlight && !text)
+        return;
+    free(g_highlight);
+    g_highlight = text ? strdup(text) : NULL;
+    ++g_highlight_gen;
+}
+
+static Span_Slot *span_slot(const Matrix *const matrix, const Line *ln) {
+    size_t hash = (size_t)((ln->off * UINT64_C(0x9E3779B97F4A7C15)) >> 32);
+    Span_Slot *slot = &matrix->cols->spans[hash % MATRIX_SPAN_SLOTS];
+    if (!slot->used || slot->off != ln->off || slot->len != ln->len) {
+        if (!slot->used) {
+            dyn_array_init(slot->spans);
+            dyn_array_init(slot->terms);
+            slot->used = 1;
+        }
+        slot->off = ln->off;
+        slot->len = ln->len;
+        slot->gen = slot->terms_gen = SIZE_MAX;
+    }
+    return slot;
+}
+
+// Finds the matches of `pattern` in `slot` that start before byte
+// `upto` (at least), searching only what has not been searched yet.
+static void search_spans(Span_Slot *slot, const char *s, const Search_Pattern *pattern, size_t upto) {
+    if (slot->gen != g_highlight_gen) {
+        dyn_array_clear(slot->spans);
+        slot->gen = g_highlight_gen;
+        slot->searched = 0;
+    }
+
+    size_t len = slot->len;
+    if (upto > len)
+        upto = len;
+
+    while (slot->searched < upto) {
+        size_t pos = slot->searched, start, end;
+
+        if (!pattern->regex) {
+            // Only as far as a match that starts before `upto` can reach.
+            size_t n = pattern->needle_len;
+            size_t limit = len < n || len - upto <= n - 1 ? len : upto + n - 1;
+            const char *at = search_pattern_forward(pattern, s + pos, limit - pos);
+            if (!at) {
+                slot->searched = limit == len ? len : limit - n + 1;
+                break;
+            }
+            start = (size_t)(at - s);
+            end = start + n;
+        }
+        else if (!filter_span(&pattern->re, s, len, pos, &start, &end)) {
+            slot->searched = len;
+            break;
+        }
 
-// Helper function to check if a character sequence starting at src[i] is valid UTF-8
-// Returns the number of bytes in the UTF-8 sequence (1-4), or 0 if invalid
-static size_t is_valid_utf8(const char *src, size_t i, size_t len) {
-    unsigned char c = src[i];
-    
-    // Single-byte ASCII (0xxxxxxx)
-    if (c <= 0x7F) return 1;
-    
-    // Multi-byte sequences
-    if (c >= 0xC2 && c <= 0xDF && i + 1 < len) { // 2-byte sequence
-        if ((src[i + 1] & 0xC0) == 0x80) return 2;
-    } else if (c >= 0xE0 && c <= 0xEF && i + 2 < len) { // 3-byte sequence
-        if ((src[i + 1] & 0xC0) == 0x80 && (src[i + 2] & 0xC0) == 0x80) return 3;
-    } else if (c >= 0xF0 && c <= 0xF4 && i + 3 < len) { // 4-byte sequence
-        if ((src[i + 1] & 0xC0) == 0x80 && (src[i + 2] & 0xC0) == 0x80 && 
-            (src[i + 3] & 0xC0) == 0x80) return 4;
-    }
-    
-    return 0; // Invalid UTF-8
+        if (end > start)
+            dyn_array_append(slot->spans, ((Match_Span) { start, end, -1 }));
+        slot->searched = end > start ? end : start + 1;
+    }
+}
+
+// Adds a term that was found to the end of `slot->terms`, where
+// they come in the order that they end. One that starts before the
+// ones it overlaps replaces them, otherwise it is dropped.
+static int found_term(void *arg, int term, size_t end) {
+    Span_Slot *slot = (Span_Slot *)arg;
+    Match_Span span = { slot->terms_scanned + end - terms_len(term), slot->terms_scanned + end, term };
+
+    while (slot->terms.len > 0 && span.start <= slot->terms.data[slot->terms.len - 1].start)
+        --slot->terms.len;
+    if (slot->terms.len == 0 || slot->terms.data[slot->terms.len - 1].end <= span.start)
+        dyn_array_append(slot->terms, span);
+    return 1;
+}
+
+// Finds every term that covers a byte before `upto` (at least),
+// a single pass however many terms there are.
+static void term_spans(Span_Slot *slot, const char *s, size_t upto) {
+    if (slot->terms_gen != terms_gen()) {
+        dyn_array_clear(slot->terms);
+        slot->terms_gen = terms_gen();
+        slot->terms_scanned = 0;
+        slot->terms_state = 0;
+    }
+
+    size_t longest = terms_longest();
+    upto = upto >= slot->len || slot->len - upto <= longest ? slot->len : upto + longest;
+    if (slot->terms_scanned < upto) {
+        // found_term() goes by where the scan started.
+        (void)terms_scan(s + slot->terms_scanned, upto - slot->terms_scanned, &slot->terms_state, found_term, slot);
+        slot->terms_scanned = upto;
+    }
+}
+
+// Walks along a row as it is drawn, switching colors at the edges
+// of the matches. The search wins over the terms.
+typedef struct {
+    const Matrix *matrix;
+    const Line *ln;
+    const Search_Pattern *pattern; // NULL if nothing is searched for
+    int terms;                     // whether there are any
+    Span_Slot *slot;
+    size_t next, next_term; // the first span that does not end before the last byte
+    size_t ahead;           // how far past the last byte to search at a time
+    const char *on;
+} Highlight;
+
+// The span of `spans` that covers `byte`, moving `next` along.
+static const Match_Span *covering(const Match_Spans *spans, size_t *next, size_t byte) {
+    while (*next < spans->len && spans->data[*next].end <= byte)
+        ++*next;
+    return *next < spans->len && spans->data[*next].start <= byte ? &spans->data[*next] : NULL;
 }
 
+static void highlight_at(Highlight *hl, size_t byte) {
+    if (!hl->pattern && !hl->terms)
+        return;
+
+    const char *s = hl->matrix->data + hl->ln->off;
+    size_t upto = byte > SIZE_MAX - hl->ahead ? SIZE_MAX : byte + hl->ahead;
+    if (!hl->slot)
+        hl->slot = span_slot(hl->matrix, hl->ln);
+    if (hl->pattern && (hl->slot->gen != g_highlight_gen || byte >= hl->slot->searched))
+        search_spans(hl->slot, s, hl->pattern, upto);
+    if (hl->terms && (hl->slot->terms_gen != terms_gen() || byte + terms_longest() > hl->slot->terms_scanned))
+        term_spans(hl->slot, s, upto);
+
+    const char *on = NULL;
+    const Match_Span *span;
+    if (hl->pattern && covering(&hl->slot->spans, &hl->next, byte))
+        on = MATRIX_HIGHLIGHT;
+    else if (hl->terms && (span = covering(&hl->slot->terms, &hl->next_term, byte)))
+        on = terms_color(span->term);
+
+    if (on != hl->on) {
+        if (hl->on)
+            fputs(RESET, stdout);
+        if (on)
+            fputs(on, stdout);
+        hl->on = on;
+    }
+}
+
+static void highlight_end(Highlight *hl) {
+    if (hl->on)
+        fputs(RESET, stdout);
+    hl->on = NULL;
+}
+
+// Takes ownership of `src`, nothing is copied. Lines
+// are indexed lazily as they are needed. This is what internal
+// buffers are made with, so -f does not apply.
 Matrix init_matrix(const char *src, char *filepath) {
-    size_t rows = 1, cols = 0, current_cols = 0;
-
-    // Count rows and columns
-    for (size_t i = 0; src[i]; ++i) {
-        if (src[i] == '\n') {
-            rows++;
-            if (current_cols > cols)
-                cols = current_cols;
-            current_cols = 0;
-        } else {
-            current_cols++;
+    return (Matrix) {
+        .data = src,
+        .len = strlen(src),
+        .index = line_index_create(0),
+        .cols = col_cache_create(),
+        .mapped = 0,
+        .pinned = 0,
+        .stream = NULL,
+        .filepath = filepath,
+    };
+}
+
+// mmap()s `filepath` so that only the pages that get drawn
+// or searched are ever read. Anything that cannot be mapped
+// (stdin, pipes, FIFOs) is streamed. On failure, `data` is NULL.
+Matrix init_matrix_from_file(char *filepath) {
+    if (!strcmp(filepath, g_stdin_fp))
+        return init_matrix_from_stream(STDIN_FILENO, filepath);
+
+    // Looked at under the same path that file_to_mmap() opens.
+    char *path = expand_tilde(filepath);
+    if (!path)
+        return (Matrix) { .data = NULL, .filepath = filepath };
+
+    struct stat st;
+    if (stat(path, &st) == -1) {
+        perror("Failed to open file");
+        free(path);
+        return (Matrix) { .data = NULL, .filepath = filepath };
+    }
+    if (!S_ISREG(st.st_mode)) {
+        int fd = open(path, O_RDONLY);
+        free(path);
+        if (fd == -1) {
+            perror("Failed to open file");
+            return (Matrix) { .data = NULL, .filepath = filepath };
         }
+        return init_matrix_from_stream(fd, filepath);
     }
-    if (current_cols > cols) cols = current_cols;
+    free(path);
+
+    // What was mapped may not be what was just stat()'d if the
+    // file was replaced in between, so its own stat() is kept.
+    size_t len = 0;
+    const char *src = file_to_mmap(filepath, &len, &st);
+    if (!src)
+        return (Matrix) { .data = NULL, .filepath = filepath };
 
     Matrix matrix = (Matrix) {
-        .data = (char *)s_malloc(rows * cols * sizeof(char)),
-        .rows = rows,
-        .cols = cols,
+        .data = src,
+        .len = len,
+        .index = line_index_create(1),
+        .cols = col_cache_create(),
+        .mapped = 1,
+        .pinned = 0,
+        .stream = NULL,
+        .dev = st.st_dev,
+        .ino = st.st_ino,
+        .mtime = st.st_mtim,
+        .filepath = filepath,
+    };
+    line_index_load(matrix.index, matrix.data, matrix.len);
+
+    return matrix;
+}
+
+// Reads `fd` as data arrives instead of all at once.
+// See stream_pump().
+Matrix init_matrix_from_stream(int fd, char *filepath) {
+    Stream *stream = stream_open(fd);
+    (void)stream_pump(stream);
+
+    return (Matrix) {
+        .data = stream->data,
+        .len = stream->len,
+        .index = line_index_create(1),
+        .cols = col_cache_create(),
+        .mapped = 0,
+        .pinned = 0,
+        .stream = stream,
         .filepath = filepath,
     };
+}
+
+// A placeholder for `filepath` that reads nothing until
+// matrix_materialize(). Only regular files are deferred, anything
+// else is opened right away (see init_matrix_from_file()) as is
+// a file that cannot be stat()'d, so that errors still show up.
+Matrix init_matrix_lazy(char *filepath) {
+    struct stat st;
+    if (!strcmp(filepath, g_stdin_fp) || stat(filepath, &st) == -1 || !S_ISREG(st.st_mode))
+        return init_matrix_from_file(filepath);
+
+    return (Matrix) {
+        .data = "",
+        .len = 0,
+        .lazy = 1,
+        .dev = st.st_dev,
+        .ino = st.st_ino,
+        .mtime = st.st_mtim,
+        .filepath = filepath,
+    };
+}
+
+// Whether the file behind an evicted buffer is still
+// what its index was built from.
+static int unchanged_since_evicted(const Matrix *const matrix) {
+    struct stat st;
+    return stat(matrix->filepath, &st) == 0
+        && st.st_dev == matrix->dev
+        && st.st_ino == matrix->ino
+        && (size_t)st.st_size == matrix->len
+        && st.st_mtim.tv_sec == matrix->mtime.tv_sec
+        && st.st_mtim.tv_nsec == matrix->mtime.tv_nsec;
+}
+
+// Stops and frees the match index, which has to happen
+// before `data` goes away or moves.
+static void drop_matches(Matrix *matrix) {
+    if (matrix->matches) {
+        match_index_free(matrix->matches);
+        matrix->matches = NULL;
+    }
+}
 
-    if (!matrix.data) {
-        perror("Failed to allocate matrix memory");
-        exit(EXIT_FAILURE);
+// Reads the file behind `matrix` again from scratch. The `&`
+// filter is kept, but has to look at every row again.
+static void matrix_reload(Matrix *matrix) {
+    char *filepath = matrix->filepath;
+    View *view = matrix->view;
+    matrix->view = NULL;
+    free_matrix(matrix);
+    *matrix = init_matrix_from_file(filepath);
+    if (!matrix->data)
+        *matrix = init_matrix(strdup(""), filepath);
+    if (view)
+        view_reset(view);
+    matrix->view = view;
+}
+
+// Reads a lazy buffer. If that fails, it becomes empty and 0 is
+// returned. Does nothing for a buffer that has already been read.
+// One that was evicted with its index is just mapped again, unless
+// the file has changed since.
+int matrix_materialize(Matrix *matrix) {
+    if (!matrix->lazy)
+        return 1;
+
+    if (matrix->index) {
+        size_t len = 0;
+        const char *data = unchanged_since_evicted(matrix) ? file_to_mmap(matrix->filepath, &len, NULL) : NULL;
+        if (data && len == matrix->len) {
+            matrix->data = data;
+            matrix->mapped = 1;
+            matrix->lazy = 0;
+            matrix->cols = col_cache_create();
+            return 1;
+        }
+        if (data && len > 0)
+            munmap((void *)data, len);
+        line_index_free(matrix->index);
+        matrix->index = NULL;
     }
 
-    memset(matrix.data, ' ', rows * cols);
+    matrix_reload(matrix);
+    return matrix->data != NULL && matrix->mapped;
+}
+
+// How many bytes `matrix` is holding on to: its contents (all of
+// them for a mapped file, whether or not they are paged in) and
+// its line index (and `&` filter).
+size_t matrix_resident(const Matrix *const matrix) {
+    size_t bytes = matrix->lazy ? 0 : matrix->len;
+    if (matrix->index)
+        bytes += line_index_memory(matrix->index);
+    if (matrix->view)
+        bytes += view_memory(matrix->view);
+    if (matrix->matches)
+        bytes += matrix->matches->lines.cap * sizeof(size_t);
+    return bytes;
+}
+
+// Whether matrix_evict() can drop anything from `matrix`. Only
+// files that can be read back from disk can be, and not while they
+// are followed. Streams and internal buffers stay as they are.
+int matrix_evictable(const Matrix *const matrix) {
+    if (matrix->lazy)
+        return matrix->index != NULL;
+    return matrix->mapped && !matrix->following;
+}
+
+// Drops what `matrix` has loaded, it is read again by
+// matrix_materialize() when it is next viewed. A fully indexed file
+// first only gives up its contents and keeps its index, so coming
+// back to it is a single mmap(). Evicting it again (or evicting one
+// that is still loading) drops everything but the path.
+void matrix_evict(Matrix *matrix) {
+    if (!matrix_evictable(matrix))
+        return;
 
-    size_t row = 0, col = 0;
+    drop_matches(matrix);
 
-    struct {
-        char *chars;
-        size_t len, cap;
-    } buf = {0};
-    {
-        buf.chars = (char *)s_malloc(80);
-        buf.cap = 80, buf.len = 0;
-        memset(buf.chars, '\0', buf.cap);
+    if (!matrix->lazy && line_index_progress(matrix->index) == -1 && line_index_indexed(matrix->index)) {
+        if (matrix->len > 0)
+            munmap((void *)matrix->data, matrix->len);
+        col_cache_free(matrix->cols);
+        matrix->cols = NULL;
+        matrix->data = "";
+        matrix->mapped = 0;
+        matrix->lazy = 1;
+        return;
     }
 
-    for (size_t i = 0; src[i];) {
-        if (src[i] == '\n') {
-            if (g_filter_pattern && !regex(g_filter_pattern, buf.chars))
-                goto not_match;
-            for (size_t j = 0; j < buf.len; ++j)
-                matrix.data[row * cols + j] = buf.chars[j];
-            row++;
-        not_match:
-            memset(buf.chars, '\0', buf.len);
-            buf.len = 0;
-            ++i; // Move past newline
-        } else {
-            // Check if the current character is valid UTF-8
-            size_t utf8_len = is_valid_utf8(src, i, strlen(src));
-            if (utf8_len == 0 || utf8_len > 1) { // Invalid UTF-8 or non-ASCII (multi-byte)
-                da_append(buf.chars, buf.len, buf.cap, char *, '?');
-                i += (utf8_len == 0) ? 1 : utf8_len; // Skip invalid byte or multi-byte sequence
-            } else {
-                // Valid ASCII (single-byte, <= 0x7F)
-                if (src[i] == '\t') {
-                        da_append(buf.chars, buf.len, buf.cap, char *, ' ');
-                        da_append(buf.chars, buf.len, buf.cap, char *, ' ');
-                        da_append(buf.chars, buf.len, buf.cap, char *, ' ');
-                        da_append(buf.chars, buf.len, buf.cap, char *, ' ');
-                } else {
-                        da_append(buf.chars, buf.len, buf.cap, char *, src[i]);
-                }
-                i += 1; // Move past single byte
-            }
+    Matrix evicted = (Matrix) {
+        .data = "",
+        .len = 0,
+        .view = matrix->view,
+        .lazy = 1,
+        .dev = matrix->dev,
+        .ino = matrix->ino,
+        .mtime = matrix->mtime,
+        .filepath = matrix->filepath,
+    };
+    matrix->view = NULL;
+    free_matrix(matrix);
+    if (evicted.view)
+        view_reset(evicted.view);
+    *matrix = evicted;
+}
+
+void free_matrix(Matrix *matrix) {
+    drop_matches(matrix);
+
+    if (matrix->view) {
+        view_free(matrix->view);
+        matrix->view = NULL;
+    }
+
+    if (matrix->lazy) {
+        if (matrix->index) {
+            line_index_free(matrix->index);
+            matrix->index = NULL;
         }
+        matrix->data = NULL;
+        return;
     }
 
-    // Handle the last line if it doesn't end with a newline
-    if (buf.len > 0) {
-        if (g_filter_pattern && !regex(g_filter_pattern, buf.chars))
-            goto skip_last_line;
-        for (size_t j = 0; j < buf.len; ++j)
-            matrix.data[row * cols + j] = buf.chars[j];
-        row++;
+    if (matrix->following)
+        (void)matrix_follow(matrix, 0);
+
+    // Stop the loader before unmapping what it is reading.
+    if (matrix->index) {
+        line_index_free(matrix->index);
+        matrix->index = NULL;
     }
-skip_last_line:
 
-    matrix.rows = row;
+    if (matrix->cols) {
+        col_cache_free(matrix->cols);
+        matrix->cols = NULL;
+    }
 
-    free(buf.chars);
+    if (matrix->stream) {
+        stream_free(matrix->stream);
+        matrix->stream = NULL;
+    }
+    else if (matrix->mapped) {
+        if (matrix->data && matrix->len > 0)
+            munmap((void *)matrix->data, matrix->len);
+    }
+    else if (strcmp(matrix->filepath, g_iu_fp) != 0)
+        free((char *)matrix->data);
+    matrix->data = NULL;
+    matrix->len = 0;
+}
 
-    return matrix;
+// The stream may have grown or moved since the last call.
+static void sync_stream(Matrix *matrix) {
+    if (matrix->stream) {
+        matrix->data = matrix->stream->data;
+        matrix->len = matrix->stream->len;
+    }
 }
 
-char *get_user_input_in_mini_buffer(char *prompt, char *last_input) {
-    assert(prompt);
+// Returns whether `row` exists, indexing up to it (or
+// waiting for the loader to get to it) if needed.
+int matrix_has_row(Matrix *matrix, size_t row) {
+    sync_stream(matrix);
+    int live = (matrix->stream && matrix->stream->fd != -1) || matrix->following;
+    if (matrix->view)
+        return view_has_row(matrix->view, matrix->index, matrix->data, matrix->len, row, live);
+    return line_index_has_row(matrix->index, matrix->data, matrix->len, row, live);
+}
+
+// The number of rows indexed so far. Never waits.
+size_t matrix_rows(const Matrix *const matrix) {
+    if (matrix->view)
+        return matrix->view->rows.len;
+    return line_index_rows(matrix->index);
+}
+
+// Indexes the rest of the file, returns the number of rows.
+size_t matrix_index_all(Matrix *matrix) {
+    (void)matrix_has_row(matrix, SIZE_MAX);
+    return matrix_rows(matrix);
+}
+
+// The first row at or after line `line` (from 0) of the file,
+// which is not the same row once lines are filtered out.
+size_t matrix_row_of_line(Matrix *matrix, size_t line) {
+    if (!matrix->view && !matrix->index->filtered)
+        return line;
+
+    // Rows are in the order of the lines they are, look for one
+    // far enough ahead and then search back.
+    size_t hi = 1;
+    while (matrix_has_row(matrix, hi - 1) && matrix_source_line(matrix, hi - 1) < line)
+        hi *= 2;
+    if (hi > matrix_rows(matrix))
+        hi = matrix_rows(matrix);
+
+    size_t lo = 0;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (matrix_source_line(matrix, mid) < line)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Turns follow mode on or off. Returns 0 if the
+// buffer is not a file that can be followed.
+int matrix_follow(Matrix *matrix, int on) {
+    if (!on) {
+        follow_unwatch(&matrix->watch);
+        matrix->following = 0;
+        return 1;
+    }
+
+    (void)matrix_materialize(matrix);
+    if (!matrix->mapped || matrix->following)
+        return matrix->following;
+
+    struct stat st;
+    if (stat(matrix->filepath, &st) == -1 || !follow_watch(matrix->filepath, &matrix->watch))
+        return 0;
+
+    // Growing remaps the file, which the match index cannot follow.
+    drop_matches(matrix);
+
+    matrix->dev = st.st_dev;
+    matrix->ino = st.st_ino;
+    matrix->following = 1;
+    (void)matrix_follow_update(matrix, NULL); // Catch up on anything written since it was opened.
+    return 1;
+}
+
+// Checks whether a followed file grew, was truncated or was
+// rotated. Growing only maps and indexes the new bytes, anything
+// else reloads the file, after which `row` (the top row shown, if
+// not NULL) is moved back onto the last page if it is past the end.
+// Returns whether the buffer changed. Nothing is done while the
+// loader is still going, it wakes the main thread once it is done
+// and the check is made again then.
+int matrix_follow_update(Matrix *matrix, size_t *row) {
+    if (!matrix->following || line_index_loading(matrix->index))
+        return 0;
+
+    struct stat st;
+    if (stat(matrix->filepath, &st) == -1)
+        return 0; // Rotated away, wait for it to come back.
+
+    size_t size = (size_t)st.st_size;
+    if (size == matrix->len && st.st_ino == matrix->ino)
+        return 0;
+
+    if (st.st_ino != matrix->ino || st.st_dev != matrix->dev || size < matrix->len) {
+        int pinned = matrix->pinned;
+        matrix_reload(matrix);
+        (void)matrix_follow(matrix, 1);
+        matrix->pinned = pinned;
+        if (row && !pinned && !matrix_has_row(matrix, *row)) {
+            size_t rows = matrix_rows(matrix);
+            *row = rows > (size_t)g_win_height ? rows - (size_t)g_win_height : 0;
+        }
+        return 1;
+    }
+
+    size_t len = 0;
+    const char *data = file_to_mmap(matrix->filepath, &len, NULL);
+    if (!data || len < matrix->len)
+        return 0;
+
+    size_t old_len = matrix->len;
+    if (old_len > 0)
+        munmap((void *)matrix->data, old_len);
+    matrix->data = data;
+    matrix->len = len;
+    line_index_extend(matrix->index, matrix->data, old_len);
+    return 1;
+}
+
+// The number of columns that `row` takes up on screen.
+size_t matrix_line_width(const Matrix *const matrix, size_t row) {
+    const Col_Slot *slot = col_slot(matrix, row, SIZE_MAX, SIZE_MAX);
+    if (slot)
+        return slot->col;
+    return matrix_col_of(matrix, row, MATRIX_LINE_AT(matrix, row)->len);
+}
+
+// Converts a byte offset inside of `row` to a screen column.
+size_t matrix_col_of(const Matrix *const matrix, size_t row, size_t byte) {
+    const Line *ln = MATRIX_LINE_AT(matrix, row);
+    const char *s = MATRIX_LINE(matrix, row);
+    Col_Mark at = seek_byte(matrix, row, byte);
+    size_t col = at.col;
+    for (size_t i = at.byte; i < byte && i < ln->len; ) {
+        Cell cell = next_cell(s, i, ln->len);
+        i += cell.bytes;
+        col += cell.width;
+    }
+    return col;
+}
 
+static void print_prompt(const char *prompt) {
     color(YELLOW BOLD UNDERLINE);
     for (int i = 0; prompt[i]; ++i) {
         if (prompt[i] == ' ' && !prompt[i+1])
@@ -133,6 +749,19 @@ char *get_user_input_in_mini_buffer(char *prompt, char *last_input) {
         putchar(prompt[i]);
     }
     color(RESET);
+}
+
+char *get_user_input_in_mini_buffer(char *prompt, char *last_input) {
+    return get_user_input_in_mini_buffer_live(prompt, last_input, NULL, NULL);
+}
+
+// Like get_user_input_in_mini_buffer(), but `on_change` (if any)
+// gets what has been typed after every edit. It may redraw the
+// screen, the prompt is drawn again below it.
+char *get_user_input_in_mini_buffer_live(char *prompt, char *last_input, Mini_Buffer_Fn on_change, void *arg) {
+    assert(prompt);
+
+    print_prompt(prompt);
 
     const size_t
         input_lim = 256,
@@ -174,12 +803,23 @@ char *get_user_input_in_mini_buffer(char *prompt, char *last_input) {
                     err_wargs("input length must be < %zu", input_lim);
                 input[input_len++] = c;
             }
+            if (on_change) {
+                // Shown before `on_change` runs, which may take a while.
+                if (!BACKSPACE(c))
+                    putchar(c);
+                screen_present();
+                on_change(input, arg);
+                clear_msg();
+                print_prompt(prompt);
+                out(input, 0);
+                continue;
+            }
         } break;
         case USER_INPUT_TYPE_UNKNOWN: break;
+        case USER_INPUT_TYPE_EVENT: continue;
         default: break;
         }
         putchar(c);
-        fflush(stdout);
     }
 
  ok:
@@ -187,15 +827,99 @@ char *get_user_input_in_mini_buffer(char *prompt, char *last_input) {
     return input;
 }
 
-void dump_matrix(const Matrix *const matrix, size_t start_row, size_t end_row, size_t start_col, size_t end_col) {
-    for (size_t i = start_row; i < end_row + start_row; ++i) {
-        for (size_t j = start_col; j < end_col + start_col; ++j) {
-            if (i >= matrix->rows || j >= matrix->cols)
-                putchar(' ');
-            else
-                putchar(MAT_AT(matrix->data, matrix->cols, i, j));
+void dump_matrix(Matrix *matrix, size_t start_row, size_t end_row, size_t start_col, size_t end_col) {
+    // `end_row` and `end_col` are a height and width, guard against
+    // callers that ask for everything with SIZE_MAX.
+    size_t last_row = end_row > SIZE_MAX - start_row ? SIZE_MAX : start_row + end_row;
+
+    // With -l, rows start with their line in the file, as wide as
+    // the last one on screen needs. Only the rows drawn are looked at.
+    int gutter = 0;
+    if (BIT_SET(g_flags, FLAG_TYPE_LINES)) {
+        size_t widest = 0;
+        if (end_row != SIZE_MAX) {
+            for (size_t i = last_row; i-- > start_row; ) {
+                if (matrix_has_row(matrix, i)) {
+                    widest = matrix_source_line(matrix, i) + 1;
+                    break;
+                }
+            }
+        }
+        gutter = MATRIX_GUTTER_WIDTH;
+        for (size_t n = widest; n >= 1000000; n /= 10)
+            ++gutter;
+        if (end_col != SIZE_MAX)
+            end_col = end_col > (size_t)gutter + 1 ? end_col - (size_t)gutter - 1 : 0;
+    }
+
+    size_t last_col = end_col > SIZE_MAX - start_col ? SIZE_MAX : start_col + end_col;
+
+    // Only the part of each row that is on screen is searched, a
+    // cell is never more than 4 bytes per column (and tabs are less).
+    const Search_Pattern *pattern = g_highlight && matrix->cols ? cached_pattern(g_highlight) : NULL;
+    int terms = terms_count() > 0 && matrix->cols;
+    size_t ahead = end_col == SIZE_MAX || end_col > SIZE_MAX / 4 - 64 ? SIZE_MAX : end_col * 4 + 64;
+
+    for (size_t i = start_row; i < last_row; ++i) {
+        if (!matrix_has_row(matrix, i)) {
+            if (end_row == SIZE_MAX) break;
+            putchar('\n');
+            continue;
+        }
+
+        if (gutter)
+            printf("%*zu ", gutter, matrix_source_line(matrix, i) + 1);
+
+        const Line *ln = MATRIX_LINE_AT(matrix, i);
+        const char *s = MATRIX_LINE(matrix, i);
+        size_t len = ln->len;
+        Highlight hl = { .matrix = matrix, .ln = ln, .pattern = pattern, .terms = terms, .ahead = ahead };
+
+        // Start from the closest known column instead of the
+        // beginning so that scrolling far right stays cheap.
+        Col_Mark at = seek_col(matrix, i, start_col);
+        size_t col = at.col;
+
+        if (ln->ascii) {
+            for (size_t j = at.byte; j < len && col < last_col; ++j) {
+                if (col >= start_col)
+                    highlight_at(&hl, j);
+                if (s[j] == '\t') {
+                    for (size_t k = 0; k < MATRIX_TAB_WIDTH && col < last_col; ++k, ++col)
+                        if (col >= start_col)
+                            putchar(' ');
+                }
+                else if (col++ >= start_col)
+                    putchar(s[j]);
+            }
+            highlight_end(&hl);
+            putchar('\n');
+            continue;
+        }
+
+        for (size_t j = at.byte; j < len && col < last_col; ) {
+            Cell cell = next_cell(s, j, len);
+            if (col + cell.width > start_col)
+                highlight_at(&hl, j);
+            if (col >= start_col && col + cell.width <= last_col) {
+                if (cell.sub)
+                    for (size_t k = 0; k < cell.width; ++k)
+                        putchar(cell.sub);
+                else
+                    fwrite(s + j, 1, cell.bytes, stdout);
+            }
+            else {
+                // A wide character cut off by the edge of the window,
+                // only the part that is inside of it is drawn (blank).
+                for (size_t k = col; k < col + cell.width && k < last_col; ++k)
+                    if (k >= start_col)
+                        putchar(' ');
+            }
+            j += cell.bytes;
+            col += cell.width;
         }
 
+        highlight_end(&hl);
         putchar('\n');
     }
 }
@@ -209,27 +933,30 @@ void handle_jump_to_beginning_of_line(Matrix *matrix, size_t line, size_t *colum
 void handle_jump_to_end_of_line(Matrix *matrix, size_t line, size_t *column) {
     reset_scrn();
 
-    if (line >= matrix->rows) return;
+    if (!matrix_has_row(matrix, line)) return;
 
-    size_t last_char_index = 0;
-    for (size_t col = 0; col < matrix->cols; col++) {
-        char ch = MAT_AT(matrix->data, matrix->cols, line, col);
-        if (!isspace(ch)) {
-            last_char_index = col;
-        }
-    }
+    const char *s = MATRIX_LINE(matrix, line);
+    size_t len = MATRIX_LINE_AT(matrix, line)->len;
+    while (len > 0 && isspace((unsigned char)s[len-1]))
+        --len;
+
+    // Back up to where the last character starts.
+    size_t last = len > 0 ? len-1 : 0;
+    while (last > 0 && ((unsigned char)s[last] & 0xC0) == 0x80)
+        --last;
 
-    *column = last_char_index;
+    *column = matrix_col_of(matrix, line, last);
 
     dump_matrix(matrix, line, g_win_height, *column, g_win_width);
 }
 
-void handle_scroll_right(const Matrix *const matrix, size_t line, size_t *const column) {
+
+void handle_scroll_right(Matrix *matrix, size_t line, size_t *const column) {
     reset_scrn();
     dump_matrix(matrix, line, g_win_height, ++(*column), g_win_width);
 }
 
-void handle_scroll_left(const Matrix *const matrix, size_t line, size_t *const column) {
+void handle_scroll_left(Matrix *matrix, size_t line, size_t *const column) {
     if (*column == 0)
         return;
 
@@ -237,7 +964,7 @@ void handle_scroll_left(const Matrix *const matrix, size_t line, size_t *const c
     dump_matrix(matrix, line, g_win_height, --(*column), g_win_width);
 }
 
-void handle_scroll_down(const Matrix *const matrix, size_t *const line, size_t column) {
+void handle_scroll_down(Matrix *matrix, size_t *const line, size_t column) {
     // Scrolling down does not need bounds checking
     // because dump_matrix will fill out-of-bounds space
     // with empty spaces.
@@ -245,81 +972,468 @@ void handle_scroll_down(const Matrix *const matrix, size_t *const line, size_t c
     dump_matrix(matrix, ++(*line), g_win_height, column, g_win_width);
 }
 
-void handle_scroll_up(const Matrix *const matrix, size_t *const line, size_t column) {
+void handle_scroll_up(Matrix *matrix, size_t *const line, size_t column) {
     if (*line > 0) {
         reset_scrn();
         dump_matrix(matrix, --(*line), g_win_height, column, g_win_width);
     }
 }
 
-void handle_jump_to_top(const Matrix *const matrix, size_t *const line, size_t column) {
+void handle_jump_to_top(Matrix *matrix, size_t *const line, size_t column) {
     reset_scrn();
     *line = 0;
     dump_matrix(matrix, *line, g_win_height, column, g_win_width);
 }
 
-void handle_jump_to_bottom(const Matrix *const matrix, size_t *const line, size_t column) {
+void handle_jump_to_bottom(Matrix *matrix, size_t *const line, size_t column) {
     reset_scrn();
-    *line = matrix->rows - g_win_height;
+
+    // Don't wait for the loader, show what is there so far
+    // and keep following the bottom until it is done.
+    if (matrix->view && matrix->index->loading)
+        view_catch_up(matrix->view, matrix->index, matrix->data);
+    size_t rows = matrix->index->loading ? matrix_rows(matrix) : matrix_index_all(matrix);
+    matrix->pinned = matrix->following || !line_index_indexed(matrix->index);
+
+    *line = rows > (size_t)g_win_height ? rows - (size_t)g_win_height : 0;
     dump_matrix(matrix, *line, g_win_height, column, g_win_width);
 }
 
-// Returns the row in which the word was found, sets the column
-// to the start of the found word.
-int find_word_in_matrix(Matrix *matrix, size_t start_row, size_t *column, char *word, size_t word_len, int reverse) {
-    size_t match = 0;
-    int found = 0;
-    size_t start_col = 0; // Track the starting column of the match
+// Returns the byte offset of the first match inside of `row`, or -1.
+static long find_in_line(const Matrix *const matrix, size_t row, const Search_Pattern *pattern) {
+    return search_pattern_find(pattern, MATRIX_LINE(matrix, row), MATRIX_LINE_AT(matrix, row)->len);
+}
 
-    if (!reverse) {
-        for (size_t i = start_row; i < matrix->rows && !found; ++i) {
-            for (size_t j = 0; j < matrix->cols && !found; ++j) {
-                if (MAT_AT(matrix->data, matrix->cols, i, j) == word[match]) {
-                    if (match == 0) {
-                        start_col = j; // Store the starting column of the match
-                    }
-                    ++match;
-                    if (match == word_len) {
-                        found = i;
-                        if (!BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
-                            *column = start_col; // Set column to the start of the match
-                        break;
-                    }
-                } else {
-                    match = 0;
-                }
+// Whether the rows of `matrix` are the lines of its data one after
+// the other, so that many of them can be searched at once. What
+// is searched for never has a newline in it, so it cannot match
+// across two lines.
+static int rows_are_contiguous(const Matrix *const matrix) {
+    return !matrix->view && !matrix->index->filtered;
+}
+
+// The bytes from the start of row `start` to the end of row `end-1`.
+static size_t span_bytes(const Matrix *const matrix, size_t start, size_t end) {
+    const Line *last = MATRIX_LINE_AT(matrix, end-1);
+    return last->off + last->len - MATRIX_LINE_AT(matrix, start)->off;
+}
+
+// The row in [lo, hi) that byte `off` of the data is in.
+static size_t row_at_offset(const Matrix *const matrix, size_t lo, size_t hi, size_t off) {
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (MATRIX_LINE_AT(matrix, mid)->off <= off)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+// Set while searching as the pattern is typed, see search_interrupted().
+static int g_search_interruptible = 0;
+
+// Whether the search should give up because a key has been pressed,
+// which is only the case while the pattern is still being typed.
+static int search_interrupted(void) {
+    return g_search_interruptible && input_pending();
+}
+
+// Whether all of the data is there and stays put, so that it can be
+// searched without going through the rows.
+static int data_is_whole(const Matrix *const matrix) {
+    return rows_are_contiguous(matrix) && matrix->data && !matrix->lazy && !matrix->stream && !matrix->following;
+}
+
+// The row that byte `off` of the data is in, indexing up to it first.
+static size_t row_of_offset(Matrix *matrix, size_t off) {
+    size_t rows = matrix_rows(matrix);
+    while (rows == 0 || MATRIX_LINE_AT(matrix, rows-1)->off + MATRIX_LINE_AT(matrix, rows-1)->len < off) {
+        (void)matrix_has_row(matrix, rows + MATRIX_SEARCH_SPAN);
+        size_t more = matrix_rows(matrix);
+        if (more == rows)
+            break;
+        rows = more;
+    }
+    return row_at_offset(matrix, 0, rows, off);
+}
+
+typedef struct {
+    const char *data;
+    size_t len;        // of `data`
+    size_t start, end; // what is searched
+    const Search_Pattern *pattern;
+    int reverse;
+    int interruptible;
+
+    size_t *hits;          // for every chunk, if it has one
+    atomic_size_t nearest; // chunk with a hit that is nearest to where it started
+    atomic_size_t bytes;
+    atomic_int interrupted;
+} Chunked_Search;
+
+// Whether the line that byte `off` is in matches the regex.
+static int line_matches(const Chunked_Search *cs, size_t off) {
+    const char *nl = memrchr(cs->data, '\n', off);
+    size_t start = nl ? (size_t)(nl - cs->data) + 1 : 0;
+    nl = memchr(cs->data + off, '\n', cs->len - off);
+    size_t end = nl ? (size_t)(nl - cs->data) : cs->len;
+    return filter_match(&cs->pattern->re, cs->data + start, end - start);
+}
+
+// The first match that starts in [from, to), or SIZE_MAX. Lines are
+// only run through the regex once, the next needle is looked for
+// after the line.
+static size_t first_in_chunk(const Chunked_Search *cs, size_t from, size_t to) {
+    size_t n = cs->pattern->needle_len;
+    size_t limit = cs->len - to < n - 1 ? cs->len : to + n - 1;
+
+    while (from < to) {
+        const char *at = search_pattern_forward(cs->pattern, cs->data + from, limit - from);
+        if (!at)
+            break;
+        size_t off = (size_t)(at - cs->data);
+        if (!cs->pattern->regex || line_matches(cs, off))
+            return off;
+        const char *nl = memchr(at, '\n', cs->len - off);
+        if (!nl)
+            break;
+        from = (size_t)(nl - cs->data) + 1;
+    }
+    return SIZE_MAX;
+}
+
+// The last match that starts in [from, to), or SIZE_MAX.
+static size_t last_in_chunk(const Chunked_Search *cs, size_t from, size_t to) {
+    size_t n = cs->pattern->needle_len;
+    size_t limit = cs->end - to < n - 1 ? cs->end : to + n - 1;
+
+    while (limit > from) {
+        const char *at = search_pattern_backward(cs->pattern, cs->data + from, limit - from);
+        if (!at)
+            break;
+        size_t off = (size_t)(at - cs->data);
+        if (!cs->pattern->regex || line_matches(cs, off))
+            return off;
+        const char *nl = memrchr(cs->data + from, '\n', off - from);
+        if (!nl)
+            break;
+        limit = (size_t)(nl - cs->data);
+    }
+    return SIZE_MAX;
+}
+
+// Chunk `i` counts from where the search started, so the nearest
+// hit is always in the chunk with the lowest number. Chunks past one
+// that has a hit are not searched at all.
+static void search_chunk(void *arg, size_t i) {
+    Chunked_Search *cs = (Chunked_Search *)arg;
+    if (i > atomic_load(&cs->nearest) || atomic_load(&cs->interrupted))
+        return;
+    if (cs->interruptible && input_pending()) {
+        atomic_store(&cs->interrupted, 1);
+        return;
+    }
+
+    size_t from, to;
+    if (!cs->reverse) {
+        from = cs->start + i * MATRIX_SEARCH_CHUNK;
+        to = cs->end - from > MATRIX_SEARCH_CHUNK ? from + MATRIX_SEARCH_CHUNK : cs->end;
+    } else {
+        to = cs->end - i * MATRIX_SEARCH_CHUNK;
+        from = to - cs->start > MATRIX_SEARCH_CHUNK ? to - MATRIX_SEARCH_CHUNK : cs->start;
+    }
+
+    size_t hit = cs->reverse ? last_in_chunk(cs, from, to) : first_in_chunk(cs, from, to);
+    atomic_fetch_add_explicit(&cs->bytes, to - from, memory_order_relaxed);
+    if (hit == SIZE_MAX)
+        return;
+
+    cs->hits[i] = hit;
+    size_t nearest = atomic_load(&cs->nearest);
+    while (i < nearest && !atomic_compare_exchange_weak(&cs->nearest, &nearest, i))
+        ;
+}
+
+// Searches bytes [start, end) of the data for the match nearest to
+// `start` (or to `end` with `reverse`), MATRIX_SEARCH_CHUNK at a time
+// over the worker pool. Returns the row it is in, -1 if there is
+// none and -2 if search_interrupted().
+static long find_chunked(Matrix *matrix, size_t start, size_t end, const Search_Pattern *pattern,
+                         int reverse, size_t *bytes) {
+    size_t chunks = (end - start + MATRIX_SEARCH_CHUNK - 1) / MATRIX_SEARCH_CHUNK;
+    Chunked_Search cs = {
+        .data = matrix->data,
+        .len = matrix->len,
+        .start = start,
+        .end = end,
+        .pattern = pattern,
+        .reverse = reverse,
+        .interruptible = g_search_interruptible,
+        .hits = (size_t *)s_malloc((chunks ? chunks : 1) * sizeof(size_t)),
+    };
+    atomic_init(&cs.nearest, SIZE_MAX);
+    atomic_init(&cs.bytes, 0);
+    atomic_init(&cs.interrupted, 0);
+
+    pool_run(chunks, search_chunk, &cs);
+
+    size_t nearest = atomic_load(&cs.nearest);
+    size_t off = nearest != SIZE_MAX ? cs.hits[nearest] : SIZE_MAX;
+    *bytes += atomic_load(&cs.bytes);
+    free(cs.hits);
+
+    if (atomic_load(&cs.interrupted))
+        return -2;
+    if (off == SIZE_MAX)
+        return -1;
+    return (long)row_of_offset(matrix, off);
+}
+
+// Searches rows from `row` on for the first one that matches.
+// When the whole file is there it is searched in chunks on the
+// worker pool (see find_chunked()). Otherwise rows that sit next to
+// each other are searched for the pattern's needle
+// MATRIX_SEARCH_SPAN of them at a time, and only the rows it turns
+// up in are run through the regex (if any). Returns -1 if there
+// is none and -2 if search_interrupted().
+static long find_forward(Matrix *matrix, size_t row, const Search_Pattern *pattern, size_t *bytes) {
+    if (pattern->needle && data_is_whole(matrix)) {
+        if (!matrix_has_row(matrix, row))
+            return -1;
+        return find_chunked(matrix, MATRIX_LINE_AT(matrix, row)->off, matrix->len, pattern, 0, bytes);
+    }
+
+    if (!rows_are_contiguous(matrix) || !pattern->needle) {
+        for (size_t i = 0; matrix_has_row(matrix, row); ++row, ++i) {
+            if (i % MATRIX_SEARCH_SPAN == MATRIX_SEARCH_SPAN - 1 && search_interrupted())
+                return -2;
+            *bytes += MATRIX_LINE_AT(matrix, row)->len;
+            if (find_in_line(matrix, row, pattern) != -1)
+                return (long)row;
+        }
+        return -1;
+    }
+
+    // Index (or wait for) a whole span before looking at it.
+    while (matrix_has_row(matrix, row + MATRIX_SEARCH_SPAN - 1) || matrix_has_row(matrix, row)) {
+        if (search_interrupted())
+            return -2;
+
+        size_t end = matrix_rows(matrix);
+        if (end > row + MATRIX_SEARCH_SPAN)
+            end = row + MATRIX_SEARCH_SPAN;
+
+        while (row < end) {
+            const char *s = MATRIX_LINE(matrix, row);
+            size_t len = span_bytes(matrix, row, end);
+            const char *at = search_pattern_forward(pattern, s, len);
+            if (!at) {
+                *bytes += len;
+                row = end;
+                break;
             }
+
+            size_t hit = row_at_offset(matrix, row, end, (size_t)(at - matrix->data));
+            *bytes += (size_t)(at - s);
+            if (!pattern->regex || find_in_line(matrix, hit, pattern) != -1)
+                return (long)hit;
+            row = hit + 1;
         }
-    } else {
-        for (size_t i = start_row + 1; i-- > 0 && !found; ) {
-            for (size_t j = 0; j < matrix->cols && !found; ++j) {
-                if (MAT_AT(matrix->data, matrix->cols, i, j) == word[match]) {
-                    if (match == 0) {
-                        start_col = j;
-                    }
-                    ++match;
-                    if (match == word_len) {
-                        found = i;
-                        if (!BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
-                            *column = start_col;
-                        break;
-                    }
-                } else {
-                    match = 0;
-                }
+    }
+    return -1;
+}
+
+// Searches rows from `row` back to the first one for the last one
+// that matches, like find_forward(). Every one of them exists already.
+static long find_backward(Matrix *matrix, size_t row, const Search_Pattern *pattern, size_t *bytes) {
+    if (pattern->needle && data_is_whole(matrix)) {
+        const Line *line = MATRIX_LINE_AT(matrix, row);
+        return find_chunked(matrix, 0, line->off + line->len, pattern, 1, bytes);
+    }
+
+    if (!rows_are_contiguous(matrix) || !pattern->needle) {
+        for (size_t i = row + 1; i-- > 0; ) {
+            *bytes += MATRIX_LINE_AT(matrix, i)->len;
+            if (find_in_line(matrix, i, pattern) != -1)
+                return (long)i;
+        }
+        return -1;
+    }
+
+    for (size_t end = row + 1; end > 0; ) {
+        size_t start = end > MATRIX_SEARCH_SPAN ? end - MATRIX_SEARCH_SPAN : 0;
+
+        while (end > start) {
+            const char *s = MATRIX_LINE(matrix, start);
+            size_t len = span_bytes(matrix, start, end);
+            const char *at = search_pattern_backward(pattern, s, len);
+            if (!at) {
+                *bytes += len;
+                end = start;
+                break;
             }
+
+            size_t hit = row_at_offset(matrix, start, end, (size_t)(at - matrix->data));
+            *bytes += len - (size_t)(at - s);
+            if (!pattern->regex || find_in_line(matrix, hit, pattern) != -1)
+                return (long)hit;
+            end = hit;
         }
     }
+    return -1;
+}
+
+static size_t search_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (size_t)ts.tv_sec * 1000000000 + (size_t)ts.tv_nsec;
+}
+
+// Returns one past the row in which the pattern was found (0 if
+// it was not found), sets the column to the start of the match.
+int find_word_in_matrix(Matrix *matrix, size_t start_row, size_t *column, const Search_Pattern *pattern, int reverse) {
+    size_t start_ns = search_now_ns(), bytes = 0;
+    long found;
+
+    if (!reverse) {
+        found = find_forward(matrix, start_row, pattern, &bytes);
+    } else {
+        if (!matrix_has_row(matrix, start_row))
+            start_row = matrix_rows(matrix)-1;
+        found = matrix_rows(matrix) > 0 ? find_backward(matrix, start_row, pattern, &bytes) : -1;
+    }
+
+    search_account(bytes, search_now_ns() - start_ns);
+
+    if (found == -1)
+        return 0;
+
+    long at = find_in_line(matrix, (size_t)found, pattern);
+    if (!BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
+        *column = matrix_col_of(matrix, (size_t)found, (size_t)at); // Set column to the start of the match
+
+    return (int)found + 1;
+}
+
+// Starts finding every match of `text` in the background, unless
+// that is already going. Streams and followed files move their data
+// around as they grow, so `n` and `N` search those line by line.
+static void start_matches(Matrix *matrix, const char *text) {
+    if (matrix->stream || matrix->following || matrix->lazy || !matrix->data)
+        return;
+    if (matrix->matches && !strcmp(matrix->matches->pattern.text, text))
+        return;
+    drop_matches(matrix);
+    matrix->matches = match_index_create(text, matrix->data, matrix->len);
+}
+
+// The next row after `row` (or before it with `reverse`) with a
+// match, looked up in the match index. Returns -1 if there is
+// none and -2 if it cannot tell (yet).
+static long next_indexed_match(Matrix *matrix, size_t row, int reverse) {
+    if (!matrix->matches || matrix->view || !matrix_has_row(matrix, row))
+        return -2;
+
+    size_t line = matrix_source_line(matrix, row);
+    while (1) {
+        size_t found;
+        int known = match_index_next(matrix->matches, line, reverse, &found);
+        if (known != 1)
+            return known == 0 ? -1 : -2;
+
+        size_t at = matrix_row_of_line(matrix, found);
+        if (matrix_has_row(matrix, at) && matrix_source_line(matrix, at) == found)
+            return (long)at;
+        line = found; // Dropped by -f, try the one after.
+    }
+}
+
+// Which match `row` is at (counting it if it is one) out of how
+// many have been found so far. Returns 0 if that is not known.
+int matrix_match_position(const Matrix *const matrix, size_t row, size_t *k, size_t *total, int *complete) {
+    if (!matrix->matches || !rows_are_contiguous(matrix) || row >= matrix_rows(matrix))
+        return 0;
+    match_index_position(matrix->matches, row, k, total, complete);
+    return 1;
+}
+
+// `g_last_search`, compiled once for as long as it stays the same.
+static Search_Pattern g_pattern;
+
+// The compiled `text`, or NULL if it is not a valid regex.
+static const Search_Pattern *cached_pattern(const char *text) {
+    if (g_pattern.text && !strcmp(g_pattern.text, text))
+        return &g_pattern;
+
+    Search_Pattern pattern;
+    if (!search_pattern_init(&pattern, text))
+        return NULL;
+    if (g_pattern.text)
+        search_pattern_free(&g_pattern);
+    g_pattern = pattern;
+    return &g_pattern;
+}
+
+typedef struct {
+    Matrix *matrix;
+    size_t start_row, line, column;
+    char *done;  // the last pattern that was searched all the way
+    long found;  // and the row it is on (or -1)
+} Search_Prompt;
+
+// Searches from where `/` was pressed for what has been typed so
+// far and shows the first match. The search gives up as soon as
+// the next key comes in, since that one starts it over again.
+static void search_prompt_changed(const char *input, void *arg) {
+    Search_Prompt *sp = (Search_Prompt *)arg;
+    Matrix *matrix = sp->matrix;
+
+    const Search_Pattern *pattern = *input ? cached_pattern(input) : NULL;
+    if (*input && !pattern)
+        return; // A regex that is not finished yet.
+    set_highlight(*input ? input : g_last_search);
+
+    long found = -1;
+    if (pattern) {
+        size_t start_ns = search_now_ns(), bytes = 0;
+        g_search_interruptible = 1;
+        found = find_forward(matrix, sp->start_row, pattern, &bytes);
+        g_search_interruptible = 0;
+        search_account(bytes, search_now_ns() - start_ns);
+        if (found == -2)
+            return;
+
+        free(sp->done);
+        sp->done = strdup(input);
+        sp->found = found;
+    }
 
-    return found ? found - 1 : 0;
+    size_t line = found >= 0 ? (size_t)found : sp->line;
+    size_t column = sp->column;
+    if (found >= 0 && !BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
+        column = matrix_col_of(matrix, line, (size_t)find_in_line(matrix, line, pattern));
+    reset_scrn();
+    dump_matrix(matrix, line, g_win_height, column, g_win_width);
 }
 
 Matrix_Action_Status handle_search(Matrix *matrix, size_t *line, size_t start_row, size_t *column, char *jump_to_next/*optional*/, int reverse) {
     char *actual = NULL;
     size_t actual_len = 0;
+    Search_Prompt sp = { .matrix = matrix, .start_row = start_row, .line = *line, .column = *column, .found = -1 };
 
-    if (!jump_to_next)
-        actual = get_user_input_in_mini_buffer("[Search]: ", g_last_search);
+    if (!jump_to_next) {
+        actual = get_user_input_in_mini_buffer_live("[Search]: ", g_last_search, search_prompt_changed, &sp);
+        if (!actual || !*actual) {
+            // Back to where it was before anything was typed.
+            set_highlight(g_last_search);
+            free(sp.done);
+            reset_scrn();
+            dump_matrix(matrix, *line, g_win_height, *column, g_win_width);
+            free(actual);
+            return MATRIX_ACTION_SEARCH_NOT_FOUND;
+        }
+    }
     else
         actual = jump_to_next;
 
@@ -329,13 +1443,31 @@ Matrix_Action_Status handle_search(Matrix *matrix, size_t *line, size_t start_ro
 
     if (actual_len == 0) return MATRIX_ACTION_SEARCH_NOT_FOUND;
 
-    size_t found = find_word_in_matrix(matrix, start_row, column, actual, actual_len, reverse);
+    const Search_Pattern *pattern = cached_pattern(actual);
+    if (!pattern) {
+        free(sp.done);
+        set_highlight(g_last_search);
+        return MATRIX_ACTION_SEARCH_INVALID_REGEX;
+    }
+
+    size_t found;
+    if (!reverse && sp.done && !strcmp(sp.done, actual)) {
+        // Already searched for while it was typed.
+        found = sp.found >= 0 ? (size_t)sp.found + 1 : 0;
+        if (found && !BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
+            *column = matrix_col_of(matrix, found-1, (size_t)find_in_line(matrix, found-1, pattern));
+    }
+    else
+        found = find_word_in_matrix(matrix, start_row, column, pattern, reverse);
+    free(sp.done);
 
     if (found) {
-        *line = found+1;
+        set_highlight(actual);
+        *line = found-1;
         dump_matrix(matrix, *line, g_win_height, *column, g_win_width);
     }
     else {
+        set_highlight(g_last_search);
         return MATRIX_ACTION_SEARCH_NOT_FOUND;
     }
 
@@ -344,14 +1476,112 @@ Matrix_Action_Status handle_search(Matrix *matrix, size_t *line, size_t start_ro
             free(g_last_search);
         g_last_search = actual;
     }
+    start_matches(matrix, actual);
 
     return MATRIX_ACTION_SEARCH_FOUND;
 }
 
+static int first_term(void *arg, int term, size_t end) {
+    (void)term;
+    *(size_t *)arg = end;
+    return 0;
+}
+
+static int last_term(void *arg, int term, size_t end) {
+    (void)term;
+    *(size_t *)arg = end;
+    return 1;
+}
+
+// The first row from `row` on (or back from it with `reverse`) that
+// has one of the `:hl` terms in it, or -1. Rows that sit next to each
+// other go through the automaton MATRIX_SEARCH_SPAN of them at a time,
+// a term never has a newline in it to match across two of them.
+static long find_term(Matrix *matrix, size_t row, int reverse) {
+    if (!rows_are_contiguous(matrix)) {
+        while (reverse || matrix_has_row(matrix, row)) {
+            size_t at = 0;
+            int state = 0;
+            (void)terms_scan(MATRIX_LINE(matrix, row), MATRIX_LINE_AT(matrix, row)->len, &state, first_term, &at);
+            if (at)
+                return (long)row;
+            if (reverse && row-- == 0)
+                break;
+            if (!reverse)
+                ++row;
+        }
+        return -1;
+    }
+
+    if (!reverse) {
+        while (matrix_has_row(matrix, row + MATRIX_SEARCH_SPAN - 1) || matrix_has_row(matrix, row)) {
+            size_t end = matrix_rows(matrix), at = 0;
+            if (end > row + MATRIX_SEARCH_SPAN)
+                end = row + MATRIX_SEARCH_SPAN;
+            const char *s = MATRIX_LINE(matrix, row);
+            int state = 0;
+            (void)terms_scan(s, span_bytes(matrix, row, end), &state, first_term, &at);
+            if (at)
+                return (long)row_at_offset(matrix, row, end, (size_t)(s - matrix->data) + at - 1);
+            row = end;
+        }
+        return -1;
+    }
+
+    if (!matrix_has_row(matrix, row))
+        row = matrix_rows(matrix) - 1;
+    for (size_t end = row + 1; end > 0; ) {
+        size_t start = end > MATRIX_SEARCH_SPAN ? end - MATRIX_SEARCH_SPAN : 0, at = 0;
+        const char *s = MATRIX_LINE(matrix, start);
+        int state = 0;
+        (void)terms_scan(s, span_bytes(matrix, start, end), &state, last_term, &at);
+        if (at)
+            return (long)row_at_offset(matrix, start, end, (size_t)(s - matrix->data) + at - 1);
+        end = start;
+    }
+    return -1;
+}
+
+// Moves to the next line (or the previous one with `reverse`) that
+// has any of the `:hl` terms in it.
+Matrix_Action_Status handle_jump_to_term(Matrix *matrix, size_t *line, size_t column, int reverse) {
+    if (terms_count() == 0)
+        return MATRIX_ACTION_NO_TERMS;
+    if (reverse && *line == 0)
+        return MATRIX_ACTION_SEARCH_NOT_FOUND;
+    if (matrix_rows(matrix) == 0 && !matrix_has_row(matrix, 0))
+        return MATRIX_ACTION_SEARCH_NOT_FOUND;
+
+    long found = find_term(matrix, reverse ? *line - 1 : *line + 1, reverse);
+    if (found == -1)
+        return MATRIX_ACTION_SEARCH_NOT_FOUND;
+
+    *line = (size_t)found;
+    reset_scrn();
+    dump_matrix(matrix, *line, g_win_height, column, g_win_width);
+    return MATRIX_ACTION_TERM_FOUND;
+}
+
 Matrix_Action_Status jump_to_last_searched_word(Matrix *matrix, size_t *line, size_t *column, int reverse) {
     if (!g_last_search) {
         return MATRIX_ACTION_SEARCH_NO_PREV;
     }
+
+    start_matches(matrix, g_last_search);
+    long row = next_indexed_match(matrix, *line, reverse);
+    if (row == -1)
+        return MATRIX_ACTION_SEARCH_NOT_FOUND;
+    if (row >= 0) {
+        *line = (size_t)row;
+        const Search_Pattern *pattern = cached_pattern(g_last_search);
+        long at = pattern ? find_in_line(matrix, *line, pattern) : -1;
+        if (at != -1 && !BIT_SET(g_flags, FLAG_TYPE_NO_SEARCH_COL_JUMP))
+            *column = matrix_col_of(matrix, *line, (size_t)at);
+        dump_matrix(matrix, *line, g_win_height, *column, g_win_width);
+        return MATRIX_ACTION_SEARCH_FOUND;
+    }
+
+    // Not searched that far yet, look line by line.
     if (!reverse) return handle_search(matrix, line, *line+1, column, g_last_search, 0);
     return handle_search(matrix, line, *line-1, column, g_last_search, 1);
 }
@@ -365,8 +1595,12 @@ void handle_page_up(Matrix *matrix, size_t *line, size_t column) {
 }
 
 void handle_page_down(Matrix *matrix, size_t *line, size_t column) {
-    size_t max_start = matrix->rows > g_win_height
-        ? matrix->rows - g_win_height
+    // Only index as far as the bottom of the next page.
+    (void)matrix_has_row(matrix, *line + g_win_height / 2 + g_win_height);
+
+    size_t rows = matrix_rows(matrix);
+    size_t max_start = rows > (size_t)g_win_height
+        ? rows - (size_t)g_win_height
         : 0;
 
     if (*line < max_start) {
@@ -377,23 +1611,115 @@ void handle_page_down(Matrix *matrix, size_t *line, size_t column) {
     }
 }
 
+// Jumps to line `user_input_line` of the file, or the next
+// one that is not filtered out.
 void handle_jump_to_line_num(Matrix *matrix, size_t *line, size_t column, int user_input_line) {
-    if (user_input_line <= 0 || user_input_line > matrix->rows) {
+    size_t row = user_input_line > 0 ? matrix_row_of_line(matrix, (size_t)user_input_line - 1) : 0;
+    if (user_input_line <= 0 || !matrix_has_row(matrix, row)) {
         err_msg_wmatrix_wargs(matrix, *line, column, "[Invalid line number: `%d`]", user_input_line);
         return;
     }
 
-    *line = user_input_line - 1;
+    *line = row;
 
     reset_scrn();
     dump_matrix(matrix, *line, g_win_height, column, g_win_width);
 }
 
+typedef struct {
+    Matrix *matrix;
+    size_t column;
+    int pushed; // a layer has been added for what is being typed
+} View_Prompt;
+
+static void view_prompt_changed(const char *input, void *arg) {
+    View_Prompt *vp = (View_Prompt *)arg;
+    Matrix *matrix = vp->matrix;
+
+    if (!*input) {
+        if (vp->pushed)
+            view_pop(matrix->view);
+        vp->pushed = 0;
+    }
+    else {
+        if (!matrix->view)
+            matrix->view = view_create();
+        // Not a valid regex (yet) keeps showing the last one.
+        if (vp->pushed)
+            (void)view_replace_top(matrix->view, input);
+        else
+            vp->pushed = view_push(matrix->view, input);
+        // Rows are only checked as far as the screen goes, and
+        // that stops as soon as the next key is pressed.
+        matrix->view->interruptible = 1;
+    }
+
+    if (matrix->view && matrix->view->layers.len == 0) {
+        view_free(matrix->view);
+        matrix->view = NULL;
+    }
+    redraw_matrix(matrix, 0, vp->column);
+}
+
+// `&`: adds a layer to the filter, so that only the rows matching
+// a pattern are shown (or, with `&!`, the ones that do not). The
+// rows update as it is typed. Enter keeps it, C-g takes it away
+// again and an empty pattern removes the last layer instead.
+void handle_filter_view(Matrix *matrix, size_t *line, size_t column) {
+    size_t top = matrix_has_row(matrix, *line) ? matrix_source_line(matrix, *line) : 0;
+    View_Prompt vp = { .matrix = matrix, .column = column, .pushed = 0 };
+
+    char *input = get_user_input_in_mini_buffer_live("[Filter]: ", NULL, view_prompt_changed, &vp);
+
+    if (!input) {
+        if (vp.pushed)
+            view_pop(matrix->view);
+    }
+    else if (!*input && matrix->view) {
+        view_pop(matrix->view);
+    }
+
+    if (matrix->view && matrix->view->layers.len == 0) {
+        view_free(matrix->view);
+        matrix->view = NULL;
+    }
+    if (matrix->view)
+        matrix->view->interruptible = 0;
+
+    // Stay on the same line, or the next one that is still shown.
+    *line = matrix_row_of_line(matrix, top);
+    if (*line > 0 && !matrix_has_row(matrix, *line))
+        *line = matrix_rows(matrix) > 0 ? matrix_rows(matrix) - 1 : 0;
+
+    free(input);
+}
+
 void redraw_matrix(Matrix *matrix, size_t line, size_t column) {
     reset_scrn();
     dump_matrix(matrix, line, g_win_height, column, g_win_width);
 }
 
+// What is going on with the buffer being viewed.
+static void print_tab_flags(const Matrix *const matrix, size_t line, int progress) {
+    if (progress != -1)
+        printf("[loading %d%%] ", progress);
+    if (matrix->following)
+        printf("[following] ");
+
+    if (matrix->view) {
+        const View *view = matrix->view;
+        putchar('[');
+        for (size_t i = 0; i < view->layers.len; ++i)
+            printf("%s&%s%s", i ? " " : "", view->layers.data[i].exclude ? "!" : "", view->layers.data[i].pattern);
+        printf("] ");
+    }
+
+    size_t k, total;
+    int complete;
+    if (matrix_match_position(matrix, line, &k, &total, &complete))
+        printf("[match %zu/%zu%s] ", k, total, complete ? "" : "+");
+}
+
 void display_tabs(Buffer_Array *buffers,
                   const Matrix *const matrix,
                   size_t line,
@@ -405,11 +1731,15 @@ void display_tabs(Buffer_Array *buffers,
     for (size_t i = 0; i < buffers->len; ++i)
         total_chars += strlen(buffers->data[i].path); // Approximate "path:line "
 
+    // Show how far along any buffer that is still loading is.
+    int progress = line_index_progress(matrix->index);
+
     if (total_chars <= max_chars) {
         for (size_t i = 0; i < buffers->len; ++i) {
             if ((int)i == current_tab_index) {
                 color(BG_GREEN BLACK);
                 printf("%s:%zu ", buffers->data[i].path, line);
+                print_tab_flags(matrix, line, progress);
                 color(RESET);
             } else {
                 color(BOLD UNDERLINE);
@@ -454,14 +1784,13 @@ void display_tabs(Buffer_Array *buffers,
         }
     }
 
-    if (start > 0) {
+    if (start > 0)
         printf("<<< ");
-        fflush(stdout);
-    }
     for (size_t i = start; i < end; ++i) {
         if ((int)i == current_tab_index) {
             color(BG_GREEN BLACK);
             printf("%s:%zu ", buffers->data[i].path, line);
+            print_tab_flags(matrix, line, progress);
             color(RESET);
         } else {
             color(BOLD UNDERLINE);
@@ -469,16 +1798,17 @@ void display_tabs(Buffer_Array *buffers,
             color(RESET);
         }
     }
-    if (end < buffers->len) {
+    if (end < buffers->len)
         printf(" >>>");
-        fflush(stdout);
-    }
 }
 
 void launch_editor(Matrix *matrix, size_t line, size_t column) {
     if (!strcmp(matrix->filepath, g_iu_fp)
         || !strcmp(matrix->filepath, g_ob_fp)
-        || !strcmp(matrix->filepath, g_qbuf_fp)) {
+        || !strcmp(matrix->filepath, g_qbuf_fp)
+        || !strcmp(matrix->filepath, g_stats_fp)
+        || !strcmp(matrix->filepath, g_grep_fp)
+        || matrix->stream) {
         err_msg_wmatrix_wargs(matrix, line, column,
                               "Cannot edit buffer `%s` as it is internal",
                               matrix->filepath);
@@ -490,22 +1820,27 @@ void launch_editor(Matrix *matrix, size_t line, size_t column) {
         return;
     }
 
+    // Open the editor on the line in the file, not the row on screen.
+    size_t file_line = line;
+    if (matrix_has_row(matrix, line))
+        file_line = matrix_source_line(matrix, line);
+
     pid_t pid = fork();
 
     if (pid == 0) { // Child process
         char line_arg[32];
 
         if (strcmp(g_editor, "vim") == 0 || strcmp(g_editor, "nvim") == 0) {
-            snprintf(line_arg, sizeof(line_arg), "+%zu", line + 1);
+            snprintf(line_arg, sizeof(line_arg), "+%zu", file_line + 1);
             execlp(g_editor, g_editor, line_arg, matrix->filepath, NULL);
         } else if (strcmp(g_editor, "nano") == 0) {
-            snprintf(line_arg, sizeof(line_arg), "+%zu", line + 1);
+            snprintf(line_arg, sizeof(line_arg), "+%zu", file_line + 1);
             execlp("nano", "nano", line_arg, matrix->filepath, NULL);
         } else if (strcmp(g_editor, "vscode") == 0) {
             snprintf(line_arg, sizeof(line_arg), "--goto");
             execlp("code", "code", line_arg, matrix->filepath, NULL);
         } else if (strcmp(g_editor, "emacs") == 0) {
-            snprintf(line_arg, sizeof(line_arg), "+%zu", line + 1);
+            snprintf(line_arg, sizeof(line_arg), "+%zu", file_line + 1);
             execlp("emacs", "emacs", line_arg, matrix->filepath, NULL);
         } else {
             fprintf(stderr, "Error: Unsupported editor `%s`\n", g_editor);
@@ -519,9 +1854,9 @@ void launch_editor(Matrix *matrix, size_t line, size_t column) {
     } else {
         perror("fork failed");
     }
+    screen_invalidate();
 
-    free(matrix->data);
-    *matrix = init_matrix(file_to_cstr(matrix->filepath), matrix->filepath);
+    matrix_reload(matrix);
     reset_scrn();
     dump_matrix(matrix, line, g_win_height, column, g_win_width);
 }
@@ -0,0 +1,182 @@
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+
+#include "pool.h"
+#include "utils.h"
+
+// Jobs run in the order that they are submitted
+// unless they are bumped to the front.
+static struct {
+    Pool_Job *head, *tail;
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    size_t workers;
+} g_pool = {
+    .head = NULL,
+    .tail = NULL,
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready = PTHREAD_COND_INITIALIZER,
+    .workers = 0,
+};
+
+static void unlink_job(Pool_Job *job) {
+    if (job->prev) job->prev->next = job->next;
+    else           g_pool.head = job->next;
+    if (job->next) job->next->prev = job->prev;
+    else           g_pool.tail = job->prev;
+    job->prev = job->next = NULL;
+    job->queued = 0;
+}
+
+static void *worker(void *arg) {
+    (void)arg;
+    while (1) {
+        pthread_mutex_lock(&g_pool.lock);
+        while (!g_pool.head)
+            pthread_cond_wait(&g_pool.ready, &g_pool.lock);
+        Pool_Job *job = g_pool.head;
+        unlink_job(job);
+        Pool_Fn fn = job->fn;
+        void *job_arg = job->arg;
+        pthread_mutex_unlock(&g_pool.lock);
+
+        fn(job_arg);
+    }
+    return NULL;
+}
+
+// Starts `workers` threads, or one per CPU if 0.
+void pool_init(size_t workers) {
+    if (workers == 0) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        workers = n > 0 ? (size_t)n : 1;
+    }
+
+    for (size_t i = 0; i < workers; ++i) {
+        pthread_t th;
+        if (pthread_create(&th, NULL, worker, NULL) != 0)
+            break;
+        pthread_detach(th);
+        ++g_pool.workers;
+    }
+
+    if (g_pool.workers == 0)
+        err("could not start any worker threads");
+}
+
+size_t pool_workers(void) {
+    return g_pool.workers;
+}
+
+void pool_submit(Pool_Job *job, Pool_Fn fn, void *arg) {
+    job->fn = fn;
+    job->arg = arg;
+
+    pthread_mutex_lock(&g_pool.lock);
+    job->next = NULL;
+    job->prev = g_pool.tail;
+    if (g_pool.tail) g_pool.tail->next = job;
+    else             g_pool.head = job;
+    g_pool.tail = job;
+    job->queued = 1;
+    pthread_cond_signal(&g_pool.ready);
+    pthread_mutex_unlock(&g_pool.lock);
+}
+
+// Moves `job` to the front of the queue because someone is
+// waiting on it. Returns 0 if it has already been picked up.
+int pool_bump(Pool_Job *job) {
+    pthread_mutex_lock(&g_pool.lock);
+    int queued = job->queued;
+    if (queued && g_pool.head != job) {
+        unlink_job(job);
+        job->next = g_pool.head;
+        g_pool.head->prev = job;
+        g_pool.head = job;
+        job->queued = 1;
+    }
+    pthread_mutex_unlock(&g_pool.lock);
+    return queued;
+}
+
+// Takes `job` back if no worker has picked it up yet.
+// Returns 1 if it was taken back and will never run.
+int pool_cancel(Pool_Job *job) {
+    pthread_mutex_lock(&g_pool.lock);
+    int queued = job->queued;
+    if (queued)
+        unlink_job(job);
+    pthread_mutex_unlock(&g_pool.lock);
+    return queued;
+}
+
+typedef struct {
+    Pool_Each_Fn fn;
+    void *arg;
+    size_t n;
+    atomic_size_t next;
+    pthread_mutex_t lock;
+    pthread_cond_t finished;
+} Run;
+
+typedef struct {
+    Run *run;
+    Pool_Job job;
+    int finished;
+} Run_Helper;
+
+static void run_some(Run *run) {
+    size_t i;
+    while ((i = atomic_fetch_add(&run->next, 1)) < run->n)
+        run->fn(run->arg, i);
+}
+
+static void run_helper(void *arg) {
+    Run_Helper *helper = (Run_Helper *)arg;
+    Run *run = helper->run;
+    run_some(run);
+
+    pthread_mutex_lock(&run->lock);
+    helper->finished = 1;
+    pthread_cond_broadcast(&run->finished);
+    pthread_mutex_unlock(&run->lock);
+}
+
+// Calls `fn(arg, i)` for every `i` below `n`, spread over the
+// workers, and returns once all of them are done. The caller works
+// through them as well, so this is safe to call from a job: if no
+// worker is free it simply does everything itself. Helpers that
+// never got to run are taken back off the queue.
+void pool_run(size_t n, Pool_Each_Fn fn, void *arg) {
+    Run run = { .fn = fn, .arg = arg, .n = n };
+    atomic_init(&run.next, 0);
+    pthread_mutex_init(&run.lock, NULL);
+    pthread_cond_init(&run.finished, NULL);
+
+    Run_Helper helpers[POOL_RUN_MAX_HELPERS];
+    size_t count = n > 1 ? n - 1 : 0;
+    if (count > g_pool.workers) count = g_pool.workers;
+    if (count > POOL_RUN_MAX_HELPERS) count = POOL_RUN_MAX_HELPERS;
+
+    // Ahead of anything else that is queued, someone is waiting on these.
+    for (size_t i = 0; i < count; ++i) {
+        helpers[i] = (Run_Helper) { .run = &run, .finished = 0 };
+        pool_submit(&helpers[i].job, run_helper, &helpers[i]);
+        (void)pool_bump(&helpers[i].job);
+    }
+
+    run_some(&run);
+
+    for (size_t i = 0; i < count; ++i) {
+        if (pool_cancel(&helpers[i].job))
+            continue;
+        pthread_mutex_lock(&run.lock);
+        while (!helpers[i].finished)
+            pthread_cond_wait(&run.finished, &run.lock);
+        pthread_mutex_unlock(&run.lock);
+    }
+
+    pthread_mutex_destroy(&run.lock);
+    pthread_cond_destroy(&run.finished);
+}
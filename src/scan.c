@@ -0,0 +1,203 @@
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "scan.h"
+#include "utf8.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+// Bytes indexed by the loaders and how long that took, see scan_account().
+static struct {
+    atomic_size_t bytes, ns;
+} g_scan;
+
+// Every byte set to `b`.
+#define SCAN_BROADCAST(b) (UINT64_C(0x0101010101010101) * (uint8_t)(b))
+
+// Portable fallback, 8 bytes at a time.
+static const char *scan_line_swar(const char *s, const char *end, int *ascii) {
+    uint64_t high = 0;
+
+    while (end - s >= 8) {
+        uint64_t w;
+        memcpy(&w, s, 8);
+        uint64_t x = w ^ SCAN_BROADCAST('\n');
+        uint64_t nl = (x - SCAN_BROADCAST(0x01)) & ~x & SCAN_BROADCAST(0x80);
+        if (nl)
+            break; // Let the byte loop find exactly where.
+        high |= w;
+        s += 8;
+    }
+
+    int non_ascii = (high & SCAN_BROADCAST(0x80)) != 0;
+    for (; s < end; ++s) {
+        if (*s == '\n') {
+            *ascii = !non_ascii;
+            return s;
+        }
+        non_ascii |= (unsigned char)*s >= 0x80;
+    }
+
+    *ascii = !non_ascii;
+    return NULL;
+}
+
+#ifdef SCAN_X86
+__attribute__((target("sse2")))
+static const char *scan_line_sse2(const char *s, const char *end, int *ascii) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    unsigned high = 0;
+
+    while (end - s >= 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)s);
+        unsigned eq = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl));
+        unsigned hi = (unsigned)_mm_movemask_epi8(v);
+        if (eq) {
+            unsigned before = (1u << __builtin_ctz(eq)) - 1;
+            *ascii = !(high | (hi & before));
+            return s + __builtin_ctz(eq);
+        }
+        high |= hi;
+        s += 16;
+    }
+
+    int tail_ascii;
+    const char *found = scan_line_swar(s, end, &tail_ascii);
+    *ascii = !high && tail_ascii;
+    return found;
+}
+
+__attribute__((target("avx2")))
+static const char *scan_line_avx2(const char *s, const char *end, int *ascii) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    unsigned high = 0;
+
+    while (end - s >= 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)s);
+        unsigned eq = (unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+        unsigned hi = (unsigned)_mm256_movemask_epi8(v);
+        if (eq) {
+            int at = __builtin_ctz(eq);
+            unsigned before = at == 0 ? 0 : (0xFFFFFFFFu >> (32 - at));
+            *ascii = !(high | (hi & before));
+            return s + at;
+        }
+        high |= hi;
+        s += 32;
+    }
+
+    int tail_ascii;
+    const char *found = scan_line_sse2(s, end, &tail_ascii);
+    *ascii = !high && tail_ascii;
+    return found;
+}
+
+__attribute__((target("avx2")))
+static size_t count_lines_avx2(const char *s, size_t len) {
+    const __m256i nl = _mm256_set1_epi8('\n');
+    size_t lines = 0, i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(s + i));
+        lines += (size_t)__builtin_popcount((unsigned)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+    }
+    for (; i < len; ++i)
+        lines += s[i] == '\n';
+    return lines;
+}
+
+__attribute__((target("sse2")))
+static size_t count_lines_sse2(const char *s, size_t len) {
+    const __m128i nl = _mm_set1_epi8('\n');
+    size_t lines = 0, i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(s + i));
+        lines += (size_t)__builtin_popcount((unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+    }
+    for (; i < len; ++i)
+        lines += s[i] == '\n';
+    return lines;
+}
+#endif // SCAN_X86
+
+static size_t count_lines_memchr(const char *s, size_t len) {
+    size_t lines = 0;
+    for (const char *end = s + len; (s = memchr(s, '\n', (size_t)(end - s))); ++s)
+        ++lines;
+    return lines;
+}
+
+// The number of newlines in `s`.
+size_t scan_count_lines(const char *s, size_t len) {
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2"))
+        return count_lines_avx2(s, len);
+    if (__builtin_cpu_supports("sse2"))
+        return count_lines_sse2(s, len);
+#endif
+    return count_lines_memchr(s, len);
+}
+
+// Finds the newline that ends the line starting at `s`, or NULL
+// if there is none before `end`. `ascii` is set to whether every
+// byte before it is ASCII, which is checked in the same pass.
+const char *scan_line(const char *s, const char *end, int *ascii) {
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2"))
+        return scan_line_avx2(s, end, ascii);
+    if (__builtin_cpu_supports("sse2"))
+        return scan_line_sse2(s, end, ascii);
+#endif
+    return scan_line_swar(s, end, ascii);
+}
+
+// Whether `s` is entirely valid UTF-8. Runs of ASCII are
+// skipped 8 bytes at a time, only multi-byte sequences are
+// looked at one by one.
+int scan_utf8_valid(const char *s, size_t len) {
+    const unsigned char *p = (const unsigned char *)s;
+    const unsigned char *end = p + len;
+
+    while (p < end) {
+        while (end - p >= 8) {
+            uint64_t w;
+            memcpy(&w, p, 8);
+            if (w & SCAN_BROADCAST(0x80))
+                break;
+            p += 8;
+        }
+        if (p >= end)
+            break;
+
+        uint32_t cp;
+        size_t n = utf8_decode((const char *)p, (size_t)(end - p), &cp);
+        if (n == 0)
+            return 0;
+        p += n;
+    }
+
+    return 1;
+}
+
+// Which implementation scan_line() is using.
+const char *scan_impl(void) {
+#ifdef SCAN_X86
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+    if (__builtin_cpu_supports("sse2")) return "sse2";
+#endif
+    return "swar";
+}
+
+// Adds `bytes` scanned for lines in `ns` to the totals. Any thread.
+void scan_account(size_t bytes, size_t ns) {
+    atomic_fetch_add_explicit(&g_scan.bytes, bytes, memory_order_relaxed);
+    atomic_fetch_add_explicit(&g_scan.ns, ns, memory_order_relaxed);
+}
+
+void scan_stats(size_t *bytes, size_t *ns) {
+    *bytes = atomic_load_explicit(&g_scan.bytes, memory_order_relaxed);
+    *ns = atomic_load_explicit(&g_scan.ns, memory_order_relaxed);
+}
@@ -0,0 +1,710 @@
+#define _GNU_SOURCE // fopencookie()
+#include <stdarg.h>
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "screen.h"
+#include "color.h"
+#include "utf8.h"
+#include "utils.h"
+
+#define SCREEN_MAX_PARAMS 16
+
+// How much of what is printed is kept before the model goes
+// through it, a few frames worth.
+#define SCREEN_MODEL_BUFFER (64 * 1024)
+
+typedef enum {
+    PARSE_GROUND,
+    PARSE_ESCAPE,
+    PARSE_CSI,
+} Parse_State;
+
+static const Screen_Attr g_plain = { SCREEN_DEFAULT_COLOR, SCREEN_DEFAULT_COLOR, 0 };
+
+// While the screen is active, stdout does not go to the terminal
+// but into `back`, a model of what the terminal would show if it
+// did. screen_present() compares that to `front`, what the
+// terminal does show, and sends only what is different. Main
+// thread only.
+static struct {
+    int active;
+    int rows, cols;
+    Screen_Cell *back, *front;
+    int front_valid; // 0 until the terminal has been cleared
+    uint64_t *back_hash, *front_hash; // of every row, see scroll()
+
+    FILE *tty;   // what stdout was
+    FILE *model; // what stdout is
+
+    // The model's cursor and what it draws with. `col` is `cols`
+    // after the last column is written until the next character,
+    // which goes on the next row.
+    int row, col;
+    Screen_Attr attr;
+
+    Parse_State state;
+    int params[SCREEN_MAX_PARAMS];
+    size_t nparams;
+    int private;
+    char utf8[4];
+    size_t utf8_len, utf8_need;
+
+    // The terminal's cursor (-1 when it is not known) and
+    // what it draws with.
+    int tty_row, tty_col;
+    Screen_Attr tty_attr;
+
+    struct {
+        char *data;
+        size_t len, cap;
+    } out; // the frame being put together
+    Screen_Stats stats;
+} g_screen;
+
+static int attr_equal(Screen_Attr a, Screen_Attr b) {
+    return a.fg == b.fg && a.bg == b.bg && a.effects == b.effects;
+}
+
+static int cell_equal(const Screen_Cell *a, const Screen_Cell *b) {
+    return a->len == b->len && a->width == b->width && attr_equal(a->attr, b->attr)
+        && !memcmp(a->bytes, b->bytes, a->len);
+}
+
+static Screen_Cell blank(Screen_Attr attr) {
+    Screen_Cell cell;
+    memset(&cell, 0, sizeof(cell));
+    cell.bytes[0] = ' ';
+    cell.len = 1;
+    cell.width = 1;
+    cell.attr = attr;
+    return cell;
+}
+
+// A blank that \033[K leaves behind.
+static int is_plain_blank(const Screen_Cell *cell) {
+    return cell->len == 1 && cell->bytes[0] == ' ' && attr_equal(cell->attr, g_plain);
+}
+
+static Screen_Cell *cell_at(Screen_Cell *grid, int row, int col) {
+    return &grid[(size_t)row * (size_t)g_screen.cols + (size_t)col];
+}
+
+// Erased cells keep the background color, like they do in a terminal.
+static Screen_Attr erased(void) {
+    return (Screen_Attr) { SCREEN_DEFAULT_COLOR, g_screen.attr.bg, 0 };
+}
+
+// Overwriting half of a wide character leaves the other half blank.
+static void unwide(int row, int col) {
+    Screen_Cell *cell = cell_at(g_screen.back, row, col);
+    if (cell->len == 0 && col > 0)
+        *cell_at(g_screen.back, row, col - 1) = blank(cell->attr);
+    else if (cell->width == 2 && col + 1 < g_screen.cols)
+        *cell_at(g_screen.back, row, col + 1) = blank(cell->attr);
+}
+
+// Erases [from, to) of `row`.
+static void erase(int row, int from, int to) {
+    if (from >= to)
+        return;
+    unwide(row, from);
+    unwide(row, to - 1);
+    Screen_Cell cell = blank(erased());
+    for (int col = from; col < to; ++col)
+        *cell_at(g_screen.back, row, col) = cell;
+}
+
+static void erase_rows(int from, int to) {
+    for (int row = from; row < to; ++row)
+        erase(row, 0, g_screen.cols);
+}
+
+static void line_feed(void) {
+    if (g_screen.row + 1 < g_screen.rows) {
+        ++g_screen.row;
+        return;
+    }
+    size_t cols = (size_t)g_screen.cols;
+    memmove(g_screen.back, g_screen.back + cols, (size_t)(g_screen.rows - 1) * cols * sizeof(Screen_Cell));
+    erase(g_screen.rows - 1, 0, g_screen.cols);
+}
+
+static void reverse_line_feed(void) {
+    if (g_screen.row > 0) {
+        --g_screen.row;
+        return;
+    }
+    size_t cols = (size_t)g_screen.cols;
+    memmove(g_screen.back + cols, g_screen.back, (size_t)(g_screen.rows - 1) * cols * sizeof(Screen_Cell));
+    erase(0, 0, g_screen.cols);
+}
+
+// Draws a character of `width` columns at the cursor.
+static void put(const char *bytes, size_t len, int width) {
+    if (width < 0)
+        return;
+
+    if (width == 0) {
+        // A combining mark goes on the character before it.
+        int col = g_screen.col - 1;
+        if (col < 0)
+            return;
+        Screen_Cell *cell = cell_at(g_screen.back, g_screen.row, col);
+        if (cell->len == 0 && col > 0)
+            cell = cell_at(g_screen.back, g_screen.row, col - 1);
+        if (cell->len + len <= SCREEN_CELL_BYTES) {
+            memcpy(cell->bytes + cell->len, bytes, len);
+            cell->len += (uint8_t)len;
+        }
+        return;
+    }
+
+    if (width > g_screen.cols)
+        return;
+    if (g_screen.col + width > g_screen.cols) {
+        g_screen.col = 0;
+        line_feed();
+    }
+
+    int row = g_screen.row, col = g_screen.col;
+    unwide(row, col);
+    if (width == 2)
+        unwide(row, col + 1);
+
+    Screen_Cell *cell = cell_at(g_screen.back, row, col);
+    memset(cell, 0, sizeof(Screen_Cell));
+    memcpy(cell->bytes, bytes, len);
+    cell->len = (uint8_t)len;
+    cell->width = (uint8_t)width;
+    cell->attr = g_screen.attr;
+    if (width == 2) {
+        Screen_Cell *right = cell_at(g_screen.back, row, col + 1);
+        memset(right, 0, sizeof(Screen_Cell));
+        right->attr = g_screen.attr;
+    }
+    g_screen.col += width;
+}
+
+static int param(size_t i, int otherwise) {
+    return i < g_screen.nparams && g_screen.params[i] ? g_screen.params[i] : otherwise;
+}
+
+static int clamp(int n, int lo, int hi) {
+    return n < lo ? lo : n > hi ? hi : n;
+}
+
+// Select Graphic Rendition, only what color.h has in it
+// and 256 colors. 24 bit colors are skipped over.
+static void sgr(void) {
+    Screen_Attr *attr = &g_screen.attr;
+    if (g_screen.nparams == 0) {
+        *attr = g_plain;
+        return;
+    }
+
+    for (size_t i = 0; i < g_screen.nparams; ++i) {
+        int p = g_screen.params[i];
+        if (p == 0)                   *attr = g_plain;
+        else if (p == 1)              attr->effects |= SCREEN_BOLD;
+        else if (p == 2)              attr->effects |= SCREEN_DIM;
+        else if (p == 3)              attr->effects |= SCREEN_ITALIC;
+        else if (p == 4)              attr->effects |= SCREEN_UNDERLINE;
+        else if (p == 7)              attr->effects |= SCREEN_INVERT;
+        else if (p == 22)             attr->effects &= ~(SCREEN_BOLD | SCREEN_DIM);
+        else if (p == 23)             attr->effects &= ~SCREEN_ITALIC;
+        else if (p == 24)             attr->effects &= ~SCREEN_UNDERLINE;
+        else if (p == 27)             attr->effects &= ~SCREEN_INVERT;
+        else if (p >= 30 && p <= 37)  attr->fg = (int16_t)(p - 30);
+        else if (p == 39)             attr->fg = SCREEN_DEFAULT_COLOR;
+        else if (p >= 40 && p <= 47)  attr->bg = (int16_t)(p - 40);
+        else if (p == 49)             attr->bg = SCREEN_DEFAULT_COLOR;
+        else if (p >= 90 && p <= 97)  attr->fg = (int16_t)(p - 90 + 8);
+        else if (p >= 100 && p <= 107) attr->bg = (int16_t)(p - 100 + 8);
+        else if ((p == 38 || p == 48) && i + 1 < g_screen.nparams) {
+            if (g_screen.params[i + 1] == 5 && i + 2 < g_screen.nparams) {
+                int16_t color = (int16_t)(g_screen.params[i + 2] & 0xFF);
+                if (p == 38) attr->fg = color;
+                else         attr->bg = color;
+                i += 2;
+            }
+            else if (g_screen.params[i + 1] == 2)
+                i += 4;
+        }
+    }
+}
+
+static void csi(char final) {
+    int last_row = g_screen.rows - 1, last_col = g_screen.cols - 1;
+    int col = g_screen.col > last_col ? last_col : g_screen.col;
+
+    switch (final) {
+    case 'm': sgr(); break;
+    case 'K':
+        if (param(0, 0) == 0)      erase(g_screen.row, col, g_screen.cols);
+        else if (param(0, 0) == 1) erase(g_screen.row, 0, col + 1);
+        else                       erase(g_screen.row, 0, g_screen.cols);
+        break;
+    case 'J':
+        if (param(0, 0) == 0) {
+            erase(g_screen.row, col, g_screen.cols);
+            erase_rows(g_screen.row + 1, g_screen.rows);
+        }
+        else if (param(0, 0) == 1) {
+            erase_rows(0, g_screen.row);
+            erase(g_screen.row, 0, col + 1);
+        }
+        else
+            erase_rows(0, g_screen.rows);
+        break;
+    case 'H':
+    case 'f':
+        g_screen.row = clamp(param(0, 1) - 1, 0, last_row);
+        g_screen.col = clamp(param(1, 1) - 1, 0, last_col);
+        break;
+    case 'A': g_screen.row = clamp(g_screen.row - param(0, 1), 0, last_row); g_screen.col = col; break;
+    case 'B': g_screen.row = clamp(g_screen.row + param(0, 1), 0, last_row); g_screen.col = col; break;
+    case 'C': g_screen.col = clamp(col + param(0, 1), 0, last_col); break;
+    case 'D': g_screen.col = clamp(col - param(0, 1), 0, last_col); break;
+    case 'G': g_screen.col = clamp(param(0, 1) - 1, 0, last_col); break;
+    case 'd': g_screen.row = clamp(param(0, 1) - 1, 0, last_row); g_screen.col = col; break;
+    default: break;
+    }
+}
+
+// The terminal turns a newline into "\r\n" (OPOST is left on),
+// so that is what the model does as well.
+static void feed(unsigned char c) {
+    switch (g_screen.state) {
+    case PARSE_GROUND:
+        if (g_screen.utf8_need) {
+            if ((c & 0xC0) == 0x80) {
+                g_screen.utf8[g_screen.utf8_len++] = (char)c;
+                if (g_screen.utf8_len < g_screen.utf8_need)
+                    return;
+                uint32_t cp;
+                if (utf8_decode(g_screen.utf8, g_screen.utf8_len, &cp))
+                    put(g_screen.utf8, g_screen.utf8_len, utf8_width(cp));
+                else
+                    put(g_screen.utf8, g_screen.utf8_len, 1);
+                g_screen.utf8_need = 0;
+                return;
+            }
+            put(g_screen.utf8, g_screen.utf8_len, 1);
+            g_screen.utf8_need = 0;
+        }
+
+        if (c == 0x1B)
+            g_screen.state = PARSE_ESCAPE;
+        else if (c == '\r')
+            g_screen.col = 0;
+        else if (c == '\n') {
+            g_screen.col = 0;
+            line_feed();
+        }
+        else if (c == '\b') {
+            if (g_screen.col >= g_screen.cols)
+                g_screen.col = g_screen.cols - 1;
+            if (g_screen.col > 0)
+                --g_screen.col;
+        }
+        else if (c == '\t') {
+            int to = (g_screen.col / 8 + 1) * 8;
+            g_screen.col = to < g_screen.cols ? to : g_screen.cols - 1;
+        }
+        else if (c < 0x20 || c == 0x7F)
+            ; // Nothing that shows up.
+        else if (c < 0x80)
+            put((const char *)&c, 1, 1);
+        else if (c >= 0xC2 && c <= 0xF4) {
+            g_screen.utf8[0] = (char)c;
+            g_screen.utf8_len = 1;
+            g_screen.utf8_need = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : 2;
+        }
+        else
+            put((const char *)&c, 1, 1);
+        break;
+
+    case PARSE_ESCAPE:
+        g_screen.state = PARSE_GROUND;
+        if (c == '[') {
+            g_screen.state = PARSE_CSI;
+            g_screen.nparams = 0;
+            g_screen.private = 0;
+        }
+        else if (c == 'M')
+            reverse_line_feed();
+        break;
+
+    case PARSE_CSI:
+        if (c >= '0' && c <= '9') {
+            if (g_screen.nparams == 0)
+                g_screen.params[g_screen.nparams++] = 0;
+            int *p = &g_screen.params[g_screen.nparams - 1];
+            if (*p < 10000)
+                *p = *p * 10 + (c - '0');
+        }
+        else if (c == ';') {
+            if (g_screen.nparams == 0)
+                g_screen.params[g_screen.nparams++] = 0;
+            if (g_screen.nparams < SCREEN_MAX_PARAMS)
+                g_screen.params[g_screen.nparams++] = 0;
+        }
+        else if (c >= '<' && c <= '?')
+            g_screen.private = 1;
+        else if (c >= 0x40 && c <= 0x7E) {
+            if (!g_screen.private)
+                csi((char)c);
+            g_screen.state = PARSE_GROUND;
+        }
+        break;
+    }
+}
+
+static ssize_t model_write(void *cookie, const char *buf, size_t size) {
+    (void)cookie;
+    for (size_t i = 0; i < size; ++i)
+        feed((unsigned char)buf[i]);
+    return (ssize_t)size;
+}
+
+static void emit(const char *s, size_t len) {
+    if (g_screen.out.len + len > g_screen.out.cap) {
+        while (g_screen.out.len + len > g_screen.out.cap)
+            g_screen.out.cap = g_screen.out.cap ? g_screen.out.cap * 2 : 4096;
+        g_screen.out.data = (char *)realloc(g_screen.out.data, g_screen.out.cap);
+    }
+    memcpy(g_screen.out.data + g_screen.out.len, s, len);
+    g_screen.out.len += len;
+}
+
+static void emitf(const char *format, ...) __attribute__((format(printf, 1, 2)));
+static void emitf(const char *format, ...) {
+    char tmp[64];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(tmp, sizeof(tmp), format, args);
+    va_end(args);
+    if (len > 0)
+        emit(tmp, (size_t)len < sizeof(tmp) ? (size_t)len : sizeof(tmp) - 1);
+}
+
+static void emit_color(int16_t color, int base, int bright) {
+    if (color == SCREEN_DEFAULT_COLOR)
+        return;
+    if (color < 8)
+        emitf(";%d", base + color);
+    else if (color < 16)
+        emitf(";%d", bright + color - 8);
+    else
+        emitf(";%d;5;%d", base + 8, color);
+}
+
+static void emit_attr(Screen_Attr attr) {
+    if (attr_equal(attr, g_screen.tty_attr))
+        return;
+    emit("\033[0", 3);
+    if (attr.effects & SCREEN_BOLD)      emit(";1", 2);
+    if (attr.effects & SCREEN_DIM)       emit(";2", 2);
+    if (attr.effects & SCREEN_ITALIC)    emit(";3", 2);
+    if (attr.effects & SCREEN_UNDERLINE) emit(";4", 2);
+    if (attr.effects & SCREEN_INVERT)    emit(";7", 2);
+    emit_color(attr.fg, 30, 90);
+    emit_color(attr.bg, 40, 100);
+    emit("m", 1);
+    g_screen.tty_attr = attr;
+}
+
+static void move_to(int row, int col) {
+    if (g_screen.tty_row == row && g_screen.tty_col == col)
+        return;
+    emitf("\033[%d;%dH", row + 1, col + 1);
+    g_screen.tty_row = row;
+    g_screen.tty_col = col;
+}
+
+// Writes the cells [from, to) of `row` in `back` out as they are.
+static void emit_cells(int row, int from, int to) {
+    move_to(row, from);
+    for (int col = from; col < to; ++col) {
+        const Screen_Cell *cell = cell_at(g_screen.back, row, col);
+        if (cell->len == 0)
+            continue;
+        emit_attr(cell->attr);
+        emit(cell->bytes, cell->len);
+        g_screen.tty_col += cell->width;
+    }
+    // Past the last column the terminal waits to wrap, where
+    // the cursor goes next is up to the terminal.
+    if (g_screen.tty_col >= g_screen.cols)
+        g_screen.tty_row = g_screen.tty_col = -1;
+}
+
+// Sends what is different in `row`, in runs that are only broken up
+// by SCREEN_SKIP_MIN or more cells that are the same. If the rest
+// of the row is blank it is cleared with \033[K instead.
+static void diff_row(int row) {
+    const Screen_Cell *back = cell_at(g_screen.back, row, 0);
+    const Screen_Cell *front = cell_at(g_screen.front, row, 0);
+    int cols = g_screen.cols;
+
+    int tail = cols;
+    while (tail > 0 && is_plain_blank(&back[tail - 1]))
+        --tail;
+
+    for (int col = 0; col < cols; ) {
+        if (cell_equal(&back[col], &front[col])) {
+            ++col;
+            continue;
+        }
+
+        int start = col, end = col + 1;
+        for (int k = end; k < cols && k - end < SCREEN_SKIP_MIN; ++k)
+            if (!cell_equal(&back[k], &front[k]))
+                end = k + 1;
+
+        // Wide characters are written whole, over both halves.
+        if (start > 0 && (back[start].len == 0 || front[start].len == 0))
+            --start;
+        if (end < cols && (back[end].len == 0 || front[end].len == 0))
+            ++end;
+
+        if (end > tail) {
+            if (start < tail)
+                emit_cells(row, start, tail);
+            else
+                move_to(row, start);
+            emit_attr(g_plain);
+            emit("\033[K", 3);
+            break;
+        }
+
+        emit_cells(row, start, end);
+        col = end;
+    }
+
+    memcpy(cell_at(g_screen.front, row, 0), back, (size_t)cols * sizeof(Screen_Cell));
+}
+
+static uint64_t row_hash(const Screen_Cell *row) {
+    uint64_t h = 1469598103934665603ull;
+    for (int col = 0; col < g_screen.cols; ++col) {
+        const Screen_Cell *cell = &row[col];
+        const unsigned char key[] = {
+            cell->len, cell->width, cell->attr.effects,
+            (unsigned char)cell->attr.fg, (unsigned char)(cell->attr.fg >> 8),
+            (unsigned char)cell->attr.bg, (unsigned char)(cell->attr.bg >> 8),
+        };
+        for (size_t i = 0; i < sizeof(key); ++i)
+            h = (h ^ key[i]) * 1099511628211ull;
+        for (size_t i = 0; i < cell->len; ++i)
+            h = (h ^ (unsigned char)cell->bytes[i]) * 1099511628211ull;
+    }
+    return h;
+}
+
+static int rows_equal(int back_row, int front_row) {
+    if (g_screen.back_hash[back_row] != g_screen.front_hash[front_row])
+        return 0;
+    const Screen_Cell *b = cell_at(g_screen.back, back_row, 0), *f = cell_at(g_screen.front, front_row, 0);
+    for (int col = 0; col < g_screen.cols; ++col)
+        if (!cell_equal(&b[col], &f[col]))
+            return 0;
+    return 1;
+}
+
+// When most of the rows have only moved up or down (like they do
+// whenever the view scrolls) they are moved on the terminal as well,
+// inside of a scroll region, and only the rows that come into view
+// are drawn. Returns 1 if it scrolled.
+static int scroll(void) {
+    int rows = g_screen.rows;
+    for (int row = 0; row < rows; ++row) {
+        g_screen.back_hash[row] = row_hash(cell_at(g_screen.back, row, 0));
+        g_screen.front_hash[row] = row_hash(cell_at(g_screen.front, row, 0));
+    }
+
+    // The run of rows `back[i] == front[i + by]` that saves the most
+    // rows from being drawn, the ones that are not the same already.
+    int best_by = 0, best_first = 0, best_last = -1, best_saved = 0;
+    for (int by = 1 - rows; by < rows; ++by) {
+        if (by == 0)
+            continue;
+        int first = -1, saved = 0;
+        for (int i = 0; i <= rows; ++i) {
+            int j = i + by;
+            if (i < rows && j >= 0 && j < rows && rows_equal(i, j)) {
+                if (first == -1)
+                    first = i, saved = 0;
+                saved += g_screen.back_hash[i] != g_screen.front_hash[i];
+                continue;
+            }
+            if (first != -1 && saved > best_saved) {
+                best_by = by;
+                best_first = first;
+                best_last = i - 1;
+                best_saved = saved;
+            }
+            first = -1;
+        }
+    }
+    if (best_saved < 2)
+        return 0;
+
+    int by = best_by;
+    int top = by > 0 ? best_first : best_first + by;
+    int bottom = by > 0 ? best_last + by : best_last;
+    int count = by > 0 ? by : -by;
+
+    // Rows that come into view are cleared with the attributes
+    // in effect, so those have to be plain.
+    emit_attr(g_plain);
+    emitf("\033[%d;%dr", top + 1, bottom + 1);
+    g_screen.tty_row = g_screen.tty_col = -1;
+    if (by > 0) {
+        move_to(bottom, 0);
+        for (int i = 0; i < count; ++i)
+            emit("\n", 1);
+    } else {
+        move_to(top, 0);
+        for (int i = 0; i < count; ++i)
+            emit("\033M", 2);
+    }
+    emit("\033[r", 3);
+    g_screen.tty_row = g_screen.tty_col = 0;
+
+    size_t cols = (size_t)g_screen.cols;
+    Screen_Cell *region = cell_at(g_screen.front, top, 0);
+    size_t moved = (size_t)(bottom - top + 1 - count) * cols;
+    Screen_Cell cell = blank(g_plain);
+    if (by > 0) {
+        memmove(region, region + (size_t)count * cols, moved * sizeof(Screen_Cell));
+        for (size_t i = moved; i < moved + (size_t)count * cols; ++i)
+            region[i] = cell;
+    } else {
+        memmove(region + (size_t)count * cols, region, moved * sizeof(Screen_Cell));
+        for (size_t i = 0; i < (size_t)count * cols; ++i)
+            region[i] = cell;
+    }
+    return 1;
+}
+
+// Takes over stdout for a terminal of `rows` by `cols`. Nothing that
+// is printed shows up until screen_present().
+void screen_init(int rows, int cols) {
+    if (rows < 1 || cols < 1 || g_screen.active)
+        return;
+
+    cookie_io_functions_t io = { .write = model_write };
+    FILE *model = fopencookie(NULL, "w", io);
+    if (!model)
+        return;
+    setvbuf(model, NULL, _IOFBF, SCREEN_MODEL_BUFFER);
+
+    size_t cells = (size_t)rows * (size_t)cols;
+    g_screen.rows = rows;
+    g_screen.cols = cols;
+    g_screen.back = (Screen_Cell *)s_malloc(cells * sizeof(Screen_Cell));
+    g_screen.front = (Screen_Cell *)s_malloc(cells * sizeof(Screen_Cell));
+    g_screen.back_hash = (uint64_t *)s_malloc((size_t)rows * sizeof(uint64_t));
+    g_screen.front_hash = (uint64_t *)s_malloc((size_t)rows * sizeof(uint64_t));
+    Screen_Cell cell = blank(g_plain);
+    for (size_t i = 0; i < cells; ++i)
+        g_screen.back[i] = g_screen.front[i] = cell;
+
+    g_screen.attr = g_plain;
+    g_screen.front_valid = 0;
+
+    fflush(stdout);
+    g_screen.tty = stdout;
+    g_screen.model = model;
+    stdout = model;
+    g_screen.active = 1;
+}
+
+// Shows the last frame and gives stdout back.
+void screen_end(void) {
+    if (!g_screen.active)
+        return;
+    screen_present();
+    g_screen.active = 0;
+    stdout = g_screen.tty;
+    fclose(g_screen.model);
+    fputs(RESET, stdout);
+    fflush(stdout);
+}
+
+// Sends the frame in one write(), unless the terminal takes less
+// than all of it at once.
+static void write_frame(void) {
+    const char *p = g_screen.out.data;
+    size_t left = g_screen.out.len;
+    while (left > 0) {
+        ssize_t n = write(fileno(g_screen.tty), p, left);
+        ++g_screen.stats.writes;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN)
+                continue;
+            return;
+        }
+        p += n;
+        left -= (size_t)n;
+    }
+}
+
+// Brings the terminal up to date with everything printed since the
+// last time, called whenever it is about to wait for a key.
+void screen_present(void) {
+    fflush(stdout);
+    if (!g_screen.active)
+        return;
+
+    int scrolled = 0;
+    if (!g_screen.front_valid) {
+        emit("\033[0m\033[2J", 8);
+        Screen_Cell cell = blank(g_plain);
+        for (size_t i = 0; i < (size_t)g_screen.rows * (size_t)g_screen.cols; ++i)
+            g_screen.front[i] = cell;
+        g_screen.tty_attr = g_plain;
+        g_screen.tty_row = g_screen.tty_col = -1;
+        g_screen.front_valid = 1;
+    }
+    else
+        scrolled = scroll();
+
+    for (int row = 0; row < g_screen.rows; ++row)
+        diff_row(row);
+
+    int col = g_screen.col < g_screen.cols ? g_screen.col : g_screen.cols - 1;
+    move_to(g_screen.row, col);
+
+    if (g_screen.out.len == 0)
+        return;
+    write_frame();
+
+    ++g_screen.stats.frames;
+    g_screen.stats.bytes += g_screen.out.len;
+    g_screen.stats.last_bytes = g_screen.out.len;
+    if (scrolled) {
+        ++g_screen.stats.scrolls;
+        g_screen.stats.scroll_bytes = g_screen.out.len;
+    }
+    g_screen.out.len = 0;
+}
+
+// Draws everything again on the next screen_present(), for when
+// something else has drawn on the terminal (like the editor).
+void screen_invalidate(void) {
+    g_screen.front_valid = 0;
+}
+
+int screen_active(void) {
+    return g_screen.active;
+}
+
+void screen_stats(Screen_Stats *stats) {
+    *stats = g_screen.stats;
+}
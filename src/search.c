@@ -0,0 +1,572 @@
+#define _GNU_SOURCE // memrchr()
+#include <stdint.h>
+#include <string.h>
+
+#include "search.h"
+#include "bless-config.h"
+#include "flags.h"
+#include "filter.h"
+#include "scan.h"
+#include "utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+// Bytes searched and how long that took, see search_account().
+static struct {
+    size_t bytes, ns;
+} g_search;
+
+// memchr() for the first byte of the needle, then a compare.
+static const char *forward_scalar(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+
+    const char *end = s + len - n + 1; // past the last place it can start
+    for (const char *p = s; p < end; ++p) {
+        p = memchr(p, needle[0], (size_t)(end - p));
+        if (!p)
+            return NULL;
+        if (!memcmp(p + 1, needle + 1, n - 1))
+            return p;
+    }
+    return NULL;
+}
+
+static const char *backward_scalar(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+
+    size_t count = len - n + 1; // places it can start
+    while (count > 0) {
+        const char *p = memrchr(s, needle[0], count);
+        if (!p)
+            return NULL;
+        if (!memcmp(p + 1, needle + 1, n - 1))
+            return p;
+        count = (size_t)(p - s);
+    }
+    return NULL;
+}
+
+#ifdef SEARCH_X86
+// Both compare 16 (or 32) places at once against the first and
+// the last byte of the needle and only look closer at the places
+// where both of those match, which is rarely more than the one.
+
+__attribute__((target("sse2")))
+static const char *forward_sse2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t count = len - n + 1;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + i + n - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (!memcmp(s + at + 1, needle + 1, n - 2))
+                return s + at;
+        }
+    }
+
+    return forward_scalar(s + i, len - i, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *forward_avx2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t count = len - n + 1;
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + i + n - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (!memcmp(s + at + 1, needle + 1, n - 2))
+                return s + at;
+        }
+    }
+
+    return forward_sse2(s + i, len - i, needle, n);
+}
+
+__attribute__((target("sse2")))
+static const char *backward_sse2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t i = len - n + 1; // places from `i` on have been looked at
+
+    while (i >= 16) {
+        i -= 16;
+        __m128i a = _mm_loadu_si128((const __m128i *)(s + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(s + i + n - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 31 - __builtin_clz(mask);
+            if (!memcmp(s + i + bit + 1, needle + 1, n - 2))
+                return s + i + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return backward_scalar(s, i + n - 1, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *backward_avx2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t i = len - n + 1;
+
+    while (i >= 32) {
+        i -= 32;
+        __m256i a = _mm256_loadu_si256((const __m256i *)(s + i));
+        __m256i b = _mm256_loadu_si256((const __m256i *)(s + i + n - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 31 - __builtin_clz(mask);
+            if (!memcmp(s + i + bit + 1, needle + 1, n - 2))
+                return s + i + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return backward_sse2(s, i + n - 1, needle, n);
+}
+#endif // SEARCH_X86
+
+// The same again for a needle that is in lower case already and
+// ignoring the case of ASCII letters in `s`. Nothing is copied: the
+// bytes are folded as they are compared, with a range check for
+// A-Z and an OR of 0x20 on those, so it costs a few more
+// instructions per block and no more passes over the data.
+
+static inline unsigned char fold(unsigned char c) {
+    return (unsigned)(c - 'A') < 26 ? c | 0x20 : c;
+}
+
+// Whether `s` folds to `needle`, which is folded already.
+static int fold_equal(const char *s, const char *needle, size_t n) {
+    for (size_t i = 0; i < n; ++i)
+        if (fold((unsigned char)s[i]) != (unsigned char)needle[i])
+            return 0;
+    return 1;
+}
+
+static const char *forward_fold_scalar(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+
+    const unsigned char first = (unsigned char)needle[0];
+    const char *end = s + len - n + 1;
+    for (const char *p = s; p < end; ++p)
+        if (fold((unsigned char)*p) == first && fold_equal(p + 1, needle + 1, n - 1))
+            return p;
+    return NULL;
+}
+
+static const char *backward_fold_scalar(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+
+    const unsigned char first = (unsigned char)needle[0];
+    for (size_t i = len - n + 1; i-- > 0; )
+        if (fold((unsigned char)s[i]) == first && fold_equal(s + i + 1, needle + 1, n - 1))
+            return s + i;
+    return NULL;
+}
+
+#ifdef SEARCH_X86
+// Bytes from 0x80 up are negative to the signed compares, so they
+// are never taken for upper case letters.
+
+__attribute__((target("sse2")))
+static inline __m128i fold_sse2(__m128i v) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_or_si128(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i fold_avx2(__m256i v) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_or_si256(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+__attribute__((target("sse2")))
+static const char *forward_fold_sse2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t count = len - n + 1;
+    size_t i = 0;
+
+    for (; i + 16 <= count; i += 16) {
+        __m128i a = fold_sse2(_mm_loadu_si128((const __m128i *)(s + i)));
+        __m128i b = fold_sse2(_mm_loadu_si128((const __m128i *)(s + i + n - 1)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (fold_equal(s + at + 1, needle + 1, n - 1))
+                return s + at;
+        }
+    }
+
+    return forward_fold_scalar(s + i, len - i, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *forward_fold_avx2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t count = len - n + 1;
+    size_t i = 0;
+
+    for (; i + 32 <= count; i += 32) {
+        __m256i a = fold_avx2(_mm256_loadu_si256((const __m256i *)(s + i)));
+        __m256i b = fold_avx2(_mm256_loadu_si256((const __m256i *)(s + i + n - 1)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        for (; mask; mask &= mask - 1) {
+            size_t at = i + (size_t)__builtin_ctz(mask);
+            if (fold_equal(s + at + 1, needle + 1, n - 1))
+                return s + at;
+        }
+    }
+
+    return forward_fold_sse2(s + i, len - i, needle, n);
+}
+
+__attribute__((target("sse2")))
+static const char *backward_fold_sse2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[n - 1]);
+    size_t i = len - n + 1;
+
+    while (i >= 16) {
+        i -= 16;
+        __m128i a = fold_sse2(_mm_loadu_si128((const __m128i *)(s + i)));
+        __m128i b = fold_sse2(_mm_loadu_si128((const __m128i *)(s + i + n - 1)));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, first), _mm_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 31 - __builtin_clz(mask);
+            if (fold_equal(s + i + bit + 1, needle + 1, n - 1))
+                return s + i + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return backward_fold_scalar(s, i + n - 1, needle, n);
+}
+
+__attribute__((target("avx2")))
+static const char *backward_fold_avx2(const char *s, size_t len, const char *needle, size_t n) {
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[n - 1]);
+    size_t i = len - n + 1;
+
+    while (i >= 32) {
+        i -= 32;
+        __m256i a = fold_avx2(_mm256_loadu_si256((const __m256i *)(s + i)));
+        __m256i b = fold_avx2(_mm256_loadu_si256((const __m256i *)(s + i + n - 1)));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, first), _mm256_cmpeq_epi8(b, last)));
+        while (mask) {
+            int bit = 31 - __builtin_clz(mask);
+            if (fold_equal(s + i + bit + 1, needle + 1, n - 1))
+                return s + i + bit;
+            mask &= ~(1u << bit);
+        }
+    }
+
+    return backward_fold_sse2(s, i + n - 1, needle, n);
+}
+#endif // SEARCH_X86
+
+// The first place `needle` (of `n` > 0 bytes) shows up in `s`, or NULL.
+const char *search_forward(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+    if (n == 1)
+        return memchr(s, needle[0], len);
+#ifdef SEARCH_X86
+    if (__builtin_cpu_supports("avx2"))
+        return forward_avx2(s, len, needle, n);
+    if (__builtin_cpu_supports("sse2"))
+        return forward_sse2(s, len, needle, n);
+#endif
+    return forward_scalar(s, len, needle, n);
+}
+
+// The last place `needle` (of `n` > 0 bytes) shows up in `s`, or NULL.
+const char *search_backward(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+    if (n == 1)
+        return memrchr(s, needle[0], len);
+#ifdef SEARCH_X86
+    if (__builtin_cpu_supports("avx2"))
+        return backward_avx2(s, len, needle, n);
+    if (__builtin_cpu_supports("sse2"))
+        return backward_sse2(s, len, needle, n);
+#endif
+    return backward_scalar(s, len, needle, n);
+}
+
+// search_forward() ignoring the case of ASCII letters, for a
+// `needle` that is all lower case.
+const char *search_forward_fold(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+#ifdef SEARCH_X86
+    if (__builtin_cpu_supports("avx2"))
+        return forward_fold_avx2(s, len, needle, n);
+    if (__builtin_cpu_supports("sse2"))
+        return forward_fold_sse2(s, len, needle, n);
+#endif
+    return forward_fold_scalar(s, len, needle, n);
+}
+
+const char *search_backward_fold(const char *s, size_t len, const char *needle, size_t n) {
+    if (len < n)
+        return NULL;
+#ifdef SEARCH_X86
+    if (__builtin_cpu_supports("avx2"))
+        return backward_fold_avx2(s, len, needle, n);
+    if (__builtin_cpu_supports("sse2"))
+        return backward_fold_sse2(s, len, needle, n);
+#endif
+    return backward_fold_scalar(s, len, needle, n);
+}
+
+// Which implementation search_forward() is using.
+const char *search_impl(void) {
+#ifdef SEARCH_X86
+    if (__builtin_cpu_supports("avx2")) return "avx2";
+    if (__builtin_cpu_supports("sse2")) return "sse2";
+#endif
+    return "memchr";
+}
+
+// Whether the BRE token at `p` is followed by something that lets
+// it match zero times or repeat.
+static int is_quantified(const char *p) {
+    return *p == '*' || !strncmp(p, "\\{", 2) || !strncmp(p, "\\?", 2) || !strncmp(p, "\\+", 2);
+}
+
+// Skips the bracket expression that starts at `p` (on the `[`).
+static const char *skip_bracket(const char *p) {
+    ++p;
+    if (*p == '^')
+        ++p;
+    if (*p == ']')
+        ++p;
+    while (*p && *p != ']') {
+        if (*p == '[' && (p[1] == ':' || p[1] == '=' || p[1] == '.')) {
+            char close = p[1];
+            p += 2;
+            while (*p && !(*p == close && p[1] == ']'))
+                ++p;
+            if (*p)
+                p += 2;
+            continue;
+        }
+        ++p;
+    }
+    return *p ? p + 1 : p;
+}
+
+// The longest run of plain characters outside of any group that
+// every match of the BRE `re` has in it, written to `out`. Returns
+// its length, 0 if there is none to rely on (like with `\|`).
+static size_t required_literal(const char *re, char *out) {
+    size_t best = 0, run = 0;
+    int depth = 0;
+
+    if (strstr(re, "\\|"))
+        return 0;
+
+    char *cur = (char *)s_malloc(strlen(re) + 1);
+    const char *p = re;
+    if (*p == '^')
+        ++p;
+
+    while (*p) {
+        char c;
+        size_t n = 1;
+
+        if (*p == '\\') {
+            if (p[1] && strchr(".*[]^$\\/", p[1])) {
+                c = p[1];
+                n = 2;
+            }
+            else {
+                if (p[1] == '(')
+                    ++depth;
+                else if (p[1] == ')')
+                    --depth;
+                else if (p[1] == '{') {
+                    const char *close = strstr(p, "\\}");
+                    p = close ? close : p + strlen(p) - 1;
+                }
+                run = 0;
+                p += p[1] ? 2 : 1;
+                continue;
+            }
+        }
+        else if (*p == '[') {
+            run = 0;
+            p = skip_bracket(p);
+            continue;
+        }
+        else if (*p == '.' || *p == '*' || (*p == '$' && !p[1])) {
+            run = 0;
+            ++p;
+            continue;
+        }
+        else {
+            c = *p;
+        }
+
+        p += n;
+        if (depth > 0 || is_quantified(p)) {
+            run = 0;
+            continue;
+        }
+
+        cur[run++] = c;
+        if (run > best) {
+            memcpy(out, cur, run);
+            best = run;
+        }
+    }
+
+    free(cur);
+    return best;
+}
+
+// Whether searching for `text` ignores case: always with -i, and
+// with --smart-case unless there is an upper case letter in it.
+int search_folds(const char *text) {
+    if (BIT_SET(g_flags, FLAG_TYPE_IGNORE_CASE))
+        return 1;
+    if (!BIT_SET(g_flags, FLAG_TYPE_SMART_CASE))
+        return 0;
+    for (const char *p = text; *p; ++p)
+        if ((unsigned)(*p - 'A') < 26)
+            return 0;
+    return 1;
+}
+
+// Prepares `text` to be searched for. Returns 0 if it
+// is a regex that does not compile.
+int search_pattern_init(Search_Pattern *pattern, const char *text) {
+    memset(pattern, 0, sizeof(Search_Pattern));
+    pattern->regex = text[0] == '/';
+    pattern->fold = search_folds(text);
+
+    if (pattern->regex) {
+        if (regcomp(&pattern->re, text + 1, pattern->fold ? REG_ICASE : 0) != 0)
+            return 0;
+        pattern->needle = (char *)s_malloc(strlen(text) + 1);
+        pattern->needle_len = required_literal(text + 1, pattern->needle);
+        if (pattern->needle_len == 0) {
+            free(pattern->needle);
+            pattern->needle = NULL;
+        }
+    }
+    else {
+        pattern->needle = strdup(text);
+        pattern->needle_len = strlen(text);
+    }
+
+    if (pattern->fold)
+        for (size_t i = 0; i < pattern->needle_len; ++i)
+            pattern->needle[i] = (char)fold((unsigned char)pattern->needle[i]);
+
+    pattern->text = strdup(text);
+    return 1;
+}
+
+// The first place the needle of `pattern` shows up in `s`, or NULL.
+// There has to be one.
+const char *search_pattern_forward(const Search_Pattern *pattern, const char *s, size_t len) {
+    if (pattern->fold)
+        return search_forward_fold(s, len, pattern->needle, pattern->needle_len);
+    return search_forward(s, len, pattern->needle, pattern->needle_len);
+}
+
+const char *search_pattern_backward(const Search_Pattern *pattern, const char *s, size_t len) {
+    if (pattern->fold)
+        return search_backward_fold(s, len, pattern->needle, pattern->needle_len);
+    return search_backward(s, len, pattern->needle, pattern->needle_len);
+}
+
+void search_pattern_free(Search_Pattern *pattern) {
+    if (pattern->regex)
+        regfree(&pattern->re);
+    free(pattern->needle);
+    free(pattern->text);
+}
+
+// Where in the line `s` the first match starts, or -1.
+long search_pattern_find(const Search_Pattern *pattern, const char *s, size_t len) {
+    const char *at = NULL;
+    if (pattern->needle && !(at = search_pattern_forward(pattern, s, len)))
+        return -1;
+    if (!pattern->regex)
+        return (long)(at - s);
+    return filter_find(&pattern->re, s, len);
+}
+
+// Calls `fn` with every whole line in [start, end) of `data` that
+// `pattern` matches (without its newline) and how many lines come
+// before it from `start`. Lines are skipped a needle at a time and
+// the newlines in between are only counted. Stops early when `fn`
+// returns 0. Returns the number of newlines that were gone over.
+size_t search_lines(const Search_Pattern *pattern, const char *data, size_t start, size_t end,
+                    Search_Line_Fn fn, void *arg) {
+    size_t line = 0;
+
+    for (size_t at = start; at < end; ) {
+        size_t line_start = at;
+
+        if (pattern->needle) {
+            const char *hit = search_pattern_forward(pattern, data + at, end - at);
+            if (!hit)
+                return line + scan_count_lines(data + at, end - at);
+            const char *nl = memrchr(data + at, '\n', (size_t)(hit - (data + at)));
+            line_start = nl ? (size_t)(nl - data) + 1 : at;
+            line += scan_count_lines(data + at, line_start - at);
+        }
+
+        const char *nl = memchr(data + line_start, '\n', end - line_start);
+        size_t line_end = nl ? (size_t)(nl - data) : end;
+
+        if ((!pattern->regex || filter_match(&pattern->re, data + line_start, line_end - line_start))
+            && !fn(arg, line, line_start, line_end))
+            return line;
+
+        line += nl != NULL;
+        at = nl ? line_end + 1 : end;
+    }
+
+    return line;
+}
+
+// Remembers how long the last search over `bytes` took. Main thread only.
+void search_account(size_t bytes, size_t ns) {
+    g_search.bytes = bytes;
+    g_search.ns = ns;
+}
+
+void search_stats(size_t *bytes, size_t *ns) {
+    *bytes = g_search.bytes;
+    *ns = g_search.ns;
+}
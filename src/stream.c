@@ -0,0 +1,178 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "stream.h"
+#include "control.h"
+#include "utils.h"
+
+static struct {
+    Stream **data;
+    size_t len, cap;
+} g_streams = {0};
+
+static int write_all(int fd, const char *buf, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, buf, n);
+        if (w == -1) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        buf += w, n -= (size_t)w;
+    }
+    return 1;
+}
+
+// Moves everything read so far into an unlinked temporary file
+// and maps it. From here on the kernel can page the stream out
+// instead of it sitting in anonymous memory.
+static int spill(Stream *stream) {
+    const char *tmpdir = getenv("TMPDIR");
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/bless-XXXXXX", tmpdir ? tmpdir : "/tmp");
+
+    int fd = mkstemp(path);
+    if (fd == -1) {
+        perror("Failed to create spill file");
+        return 0;
+    }
+    unlink(path);
+
+    if (!write_all(fd, stream->data, stream->len)) {
+        perror("Failed to write spill file");
+        close(fd);
+        return 0;
+    }
+
+    void *data = mmap(NULL, stream->cap, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        perror("Failed to mmap spill file");
+        close(fd);
+        return 0;
+    }
+
+    free(stream->data);
+    stream->data = (char *)data;
+    stream->spill_fd = fd;
+    return 1;
+}
+
+static void append(Stream *stream, const char *buf, size_t n) {
+    if (stream->spill_fd == -1 && stream->len + n > STREAM_SPILL_SIZE)
+        (void)spill(stream); // Keep growing the heap if it fails.
+
+    if (stream->spill_fd == -1) {
+        if (stream->len + n > stream->cap) {
+            while (stream->len + n > stream->cap)
+                stream->cap *= 2;
+            stream->data = realloc(stream->data, stream->cap);
+        }
+        memcpy(stream->data + stream->len, buf, n);
+        stream->len += n;
+        return;
+    }
+
+    if (!write_all(stream->spill_fd, buf, n)) {
+        perror("Failed to write spill file");
+        return;
+    }
+
+    // The mapping is larger than the file so that it only has to
+    // move when the capacity doubles. Nothing past `len` is touched.
+    if (stream->len + n > stream->cap) {
+        munmap(stream->data, stream->cap);
+        while (stream->len + n > stream->cap)
+            stream->cap *= 2;
+        void *data = mmap(NULL, stream->cap, PROT_READ, MAP_SHARED, stream->spill_fd, 0);
+        if (data == MAP_FAILED)
+            err("Failed to grow the spill file mapping");
+        stream->data = (char *)data;
+    }
+    stream->len += n;
+}
+
+static void finish(Stream *stream) {
+    input_unwatch(stream->fd);
+    close(stream->fd);
+    stream->fd = -1;
+}
+
+Stream *stream_open(int fd) {
+    Stream *stream = (Stream *)s_malloc(sizeof(Stream));
+    stream->fd = fd;
+    stream->cap = 4096;
+    stream->data = (char *)s_malloc(stream->cap);
+    stream->len = 0;
+    stream->spill_fd = -1;
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    input_watch(fd);
+
+    da_append(g_streams.data, g_streams.len, g_streams.cap, Stream **, stream);
+    return stream;
+}
+
+// Reads whatever the producer has written without blocking.
+// Returns the number of bytes appended.
+size_t stream_pump(Stream *stream) {
+    char buf[64 * 1024];
+    size_t total = 0;
+
+    while (stream->fd != -1 && total < STREAM_PUMP_LIMIT) {
+        ssize_t n = read(stream->fd, buf, sizeof(buf));
+        if (n > 0) {
+            append(stream, buf, (size_t)n);
+            total += (size_t)n;
+        }
+        else if (n == -1 && errno == EINTR)
+            continue;
+        else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        else
+            finish(stream); // EOF or a read error
+    }
+
+    return total;
+}
+
+void stream_pump_all(void) {
+    for (size_t i = 0; i < g_streams.len; ++i)
+        (void)stream_pump(g_streams.data[i]);
+}
+
+// Blocks until the producer closes its end.
+void stream_read_all(Stream *stream) {
+    while (stream->fd != -1) {
+        if (stream_pump(stream) == 0 && stream->fd != -1) {
+            struct pollfd pfd = { .fd = stream->fd, .events = POLLIN };
+            (void)poll(&pfd, 1, -1);
+        }
+    }
+}
+
+void stream_free(Stream *stream) {
+    for (size_t i = 0; i < g_streams.len; ++i) {
+        if (g_streams.data[i] == stream) {
+            da_remove(g_streams.data, g_streams.len, i);
+            break;
+        }
+    }
+
+    if (stream->fd != -1)
+        finish(stream);
+
+    if (stream->spill_fd != -1) {
+        munmap(stream->data, stream->cap);
+        close(stream->spill_fd);
+    }
+    else
+        free(stream->data);
+
+    free(stream);
+}
@@ -0,0 +1,206 @@
+#include <stdint.h>
+#include <string.h>
+
+#include "terms.h"
+#include "color.h"
+#include "utils.h"
+
+// Each term gets the first color that is not taken.
+static const char *g_colors[TERMS_MAX] = {
+    BLACK BG_YELLOW,
+    BLACK BG_CYAN,
+    BLACK BG_MAGENTA,
+    BLACK BG_GREEN,
+    WHITE BG_BLUE,
+    WHITE BG_RED,
+    BLACK BG_WHITE,
+    WHITE BG_GRAY,
+};
+
+// The terms that are highlighted (see `:hl`), along with an
+// Aho-Corasick automaton for all of them. It is turned into a DFA
+// (every state has a next state for every byte) so that scanning
+// is a single table lookup per byte, however many terms there are.
+// Main thread only.
+static struct {
+    struct {
+        char *text;
+        size_t len;
+        int color;
+    } terms[TERMS_MAX];
+    size_t len;
+    size_t gen; // changes with the terms
+
+    int32_t *next;  // [state * 256 + byte]
+    int32_t *match; // the longest term that ends in the state, or -1
+    size_t states;
+} g_terms;
+
+// Builds the automaton again. The trie is built first, then the
+// failure links in breadth first order, which fills in the moves
+// that the trie does not have from the state the link goes to.
+static void build(void) {
+    size_t cap = 1;
+    for (size_t i = 0; i < g_terms.len; ++i)
+        cap += g_terms.terms[i].len;
+
+    free(g_terms.next);
+    free(g_terms.match);
+    g_terms.next = (int32_t *)s_malloc(cap * 256 * sizeof(int32_t));
+    g_terms.match = (int32_t *)s_malloc(cap * sizeof(int32_t));
+    int32_t *fail = (int32_t *)s_malloc(cap * sizeof(int32_t));
+    int32_t *queue = (int32_t *)s_malloc(cap * sizeof(int32_t));
+
+    memset(g_terms.next, -1, cap * 256 * sizeof(int32_t));
+    memset(g_terms.match, -1, cap * sizeof(int32_t));
+    g_terms.states = 1;
+
+    for (size_t i = 0; i < g_terms.len; ++i) {
+        int32_t state = 0;
+        for (size_t j = 0; j < g_terms.terms[i].len; ++j) {
+            unsigned char c = (unsigned char)g_terms.terms[i].text[j];
+            int32_t *to = &g_terms.next[(size_t)state * 256 + c];
+            if (*to == -1)
+                *to = (int32_t)g_terms.states++;
+            state = *to;
+        }
+        g_terms.match[state] = (int32_t)i;
+    }
+
+    size_t head = 0, tail = 0;
+    fail[0] = 0;
+    for (int c = 0; c < 256; ++c) {
+        int32_t *to = &g_terms.next[c];
+        if (*to == -1)
+            *to = 0;
+        else {
+            fail[*to] = 0;
+            queue[tail++] = *to;
+        }
+    }
+
+    while (head < tail) {
+        int32_t state = queue[head++];
+        // A shorter term that ends here too, unless one of its own does.
+        if (g_terms.match[state] == -1)
+            g_terms.match[state] = g_terms.match[fail[state]];
+
+        for (int c = 0; c < 256; ++c) {
+            int32_t *to = &g_terms.next[(size_t)state * 256 + c];
+            int32_t through = g_terms.next[(size_t)fail[state] * 256 + c];
+            if (*to == -1)
+                *to = through;
+            else {
+                fail[*to] = through;
+                queue[tail++] = *to;
+            }
+        }
+    }
+
+    free(fail);
+    free(queue);
+    ++g_terms.gen;
+}
+
+static int find(const char *text) {
+    for (size_t i = 0; i < g_terms.len; ++i)
+        if (!strcmp(g_terms.terms[i].text, text))
+            return (int)i;
+    return -1;
+}
+
+// Adds `text` to the terms. Returns 0 if it already is one, is
+// empty or too long, or there is no color left for it.
+int terms_add(const char *text) {
+    size_t len = strlen(text);
+    if (len == 0 || len > TERMS_TEXT_MAX || g_terms.len >= TERMS_MAX || find(text) != -1)
+        return 0;
+
+    int color = 0;
+    for (int taken = 1; taken; ) {
+        taken = 0;
+        for (size_t i = 0; i < g_terms.len; ++i)
+            if (g_terms.terms[i].color == color)
+                taken = 1;
+        color += taken;
+    }
+
+    size_t i = g_terms.len++;
+    g_terms.terms[i].text = strdup(text);
+    g_terms.terms[i].len = len;
+    g_terms.terms[i].color = color;
+    build();
+    return 1;
+}
+
+// Returns 0 if `text` is not one of the terms.
+int terms_remove(const char *text) {
+    int i = find(text);
+    if (i == -1)
+        return 0;
+
+    free(g_terms.terms[i].text);
+    memmove(&g_terms.terms[i], &g_terms.terms[i + 1], (g_terms.len - (size_t)i - 1) * sizeof(g_terms.terms[0]));
+    --g_terms.len;
+    build();
+    return 1;
+}
+
+void terms_clear(void) {
+    for (size_t i = 0; i < g_terms.len; ++i)
+        free(g_terms.terms[i].text);
+    g_terms.len = 0;
+    build();
+}
+
+size_t terms_count(void) {
+    return g_terms.len;
+}
+
+const char *terms_text(int term) {
+    return g_terms.terms[term].text;
+}
+
+size_t terms_len(int term) {
+    return g_terms.terms[term].len;
+}
+
+// The escape sequence that `term` is drawn with.
+const char *terms_color(int term) {
+    return g_colors[g_terms.terms[term].color];
+}
+
+size_t terms_longest(void) {
+    size_t longest = 0;
+    for (size_t i = 0; i < g_terms.len; ++i)
+        if (g_terms.terms[i].len > longest)
+            longest = g_terms.terms[i].len;
+    return longest;
+}
+
+// Changes whenever the terms do, for anything that has kept
+// what it found with the old ones around.
+size_t terms_gen(void) {
+    return g_terms.gen;
+}
+
+// Runs `s` through the automaton, starting (and leaving off) in
+// `*state`, which is 0 at the start of a line. Calls `fn` for every
+// place a term ends. Returns how many bytes were scanned, less than
+// `len` only if `fn` stopped it.
+size_t terms_scan(const char *s, size_t len, int *state, Terms_Fn fn, void *arg) {
+    if (g_terms.len == 0)
+        return len;
+
+    const int32_t *next = g_terms.next, *match = g_terms.match;
+    int32_t at = *state;
+    for (size_t i = 0; i < len; ++i) {
+        at = next[(size_t)at * 256 + (unsigned char)s[i]];
+        if (match[at] != -1 && !fn(arg, match[at], i + 1)) {
+            *state = at;
+            return i + 1;
+        }
+    }
+    *state = at;
+    return len;
+}
@@ -4,6 +4,7 @@
 #include <regex.h>
 
 #include "utils.h"
+#include "bless-config.h"
 
 int regex(const char *pattern, const char *s) {
     regex_t regex;
@@ -33,12 +34,11 @@ void out(const char *msg, int newline) {
     printf("%s", msg);
     if (newline)
         putchar('\n');
-    fflush(stdout);
 }
 
 char get_char(void) {
     char ch;
-    read(STDIN_FILENO, &ch, 1);
+    read(g_tty_fd, &ch, 1);
     return ch;
 }
 
@@ -49,7 +49,6 @@ void clear_msg(void) {
 void reset_scrn(void) {
     printf("\033[2J");
     printf("\033[H");
-    fflush(stdout);
 }
 
 void append_str(char **dest, size_t *size, const char *format, ...) {
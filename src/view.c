@@ -0,0 +1,240 @@
+#define _GNU_SOURCE // memmem()
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "view.h"
+#include "filter.h"
+#include "control.h"
+#include "utils.h"
+
+static int is_literal(const char *pattern) {
+    return strpbrk(pattern, "\\.[]*^$") == NULL;
+}
+
+// A leading `!` makes the layer exclude what matches the rest.
+// Returns 0 for an empty or invalid pattern.
+static int layer_init(View_Layer *layer, const char *pattern) {
+    memset(layer, 0, sizeof(View_Layer));
+    layer->exclude = pattern[0] == '!';
+    if (layer->exclude)
+        ++pattern;
+    if (!*pattern)
+        return 0;
+
+    layer->literal = is_literal(pattern);
+    if (!layer->literal && regcomp(&layer->re, pattern, REG_NOSUB) != 0)
+        return 0;
+
+    layer->pattern = strdup(pattern);
+    layer->pattern_len = strlen(pattern);
+    return 1;
+}
+
+static void layer_free(View_Layer *layer) {
+    if (!layer->literal)
+        regfree(&layer->re);
+    free(layer->pattern);
+    free(layer->bits);
+    free(layer->wider);
+}
+
+// Whether every row that `narrower` matches is also matched by
+// `layer`, so that it only has to look at the rows `layer` did.
+// Only known for plain text that was typed onto the end of it.
+static int layer_narrows(const View_Layer *layer, const View_Layer *narrower) {
+    return layer->literal && narrower->literal
+        && layer->exclude == narrower->exclude
+        && narrower->pattern_len > layer->pattern_len
+        && !strncmp(narrower->pattern, layer->pattern, layer->pattern_len);
+}
+
+static int layer_matches(const View_Layer *layer, const char *s, size_t len) {
+    if (layer->literal)
+        return memmem(s, len, layer->pattern, layer->pattern_len) != NULL;
+    return filter_match(&layer->re, s, len);
+}
+
+static int is_set(const uint64_t *bits, size_t row) {
+    return (bits[row / 64] >> (row % 64)) & 1;
+}
+
+// Matches the rows of `layer` up to `end`.
+static void layer_fill(View_Layer *layer, Line_Index *index, const char *data, size_t end) {
+    size_t words = (end + 63) / 64;
+    if (words > layer->words) {
+        size_t cap = layer->words * 2 > words ? layer->words * 2 : words;
+        layer->bits = (uint64_t *)realloc(layer->bits, cap * sizeof(uint64_t));
+        memset(layer->bits + layer->words, 0, (cap - layer->words) * sizeof(uint64_t));
+        layer->words = cap;
+    }
+
+    for (size_t r = layer->checked; r < end; ++r) {
+        if (layer->wider && r < layer->wider_checked) {
+            if (r % 64 == 0 && r + 64 <= layer->wider_checked && !layer->wider[r / 64]) {
+                r += 63;
+                continue;
+            }
+            if (!is_set(layer->wider, r))
+                continue;
+        }
+        const Line *ln = line_index_at(index, r);
+        if (layer_matches(layer, data + ln->off, ln->len))
+            layer->bits[r / 64] |= UINT64_C(1) << (r % 64);
+    }
+    if (end > layer->checked)
+        layer->checked = end;
+
+    if (layer->wider && layer->checked >= layer->wider_checked) {
+        free(layer->wider);
+        layer->wider = NULL;
+    }
+}
+
+// The layers changed, combine them again from the start. Their
+// bits are kept, so this does not match anything again.
+static void invalidate(View *view) {
+    view->rows.len = 0;
+    view->checked = 0;
+}
+
+View *view_create(void) {
+    View *view = (View *)s_malloc(sizeof(View));
+    memset(view, 0, sizeof(View));
+    return view;
+}
+
+void view_free(View *view) {
+    for (size_t i = 0; i < view->layers.len; ++i)
+        layer_free(&view->layers.data[i]);
+    free(view->layers.data);
+    free(view->rows.data);
+    free(view);
+}
+
+// Forgets every row, for when the buffer has been read again.
+void view_reset(View *view) {
+    for (size_t i = 0; i < view->layers.len; ++i) {
+        View_Layer *layer = &view->layers.data[i];
+        if (layer->bits)
+            memset(layer->bits, 0, layer->words * sizeof(uint64_t));
+        layer->checked = 0;
+        free(layer->wider);
+        layer->wider = NULL;
+    }
+    invalidate(view);
+}
+
+// Adds a layer on top. Returns 0 (and changes nothing) if
+// `pattern` is not valid.
+int view_push(View *view, const char *pattern) {
+    View_Layer layer;
+    if (!layer_init(&layer, pattern))
+        return 0;
+    da_append(view->layers.data, view->layers.len, view->layers.cap, View_Layer *, layer);
+    invalidate(view);
+    return 1;
+}
+
+// Changes the pattern of the top layer, for while it is typed.
+// Returns 0 (and changes nothing) if `pattern` is not valid.
+int view_replace_top(View *view, const char *pattern) {
+    assert(view->layers.len > 0);
+    View_Layer *top = &view->layers.data[view->layers.len - 1];
+
+    View_Layer layer;
+    if (!layer_init(&layer, pattern))
+        return 0;
+
+    if (layer_narrows(top, &layer) && !top->wider) {
+        layer.wider = top->bits;
+        layer.wider_checked = top->checked;
+        top->bits = NULL;
+    }
+    layer_free(top);
+    *top = layer;
+    invalidate(view);
+    return 1;
+}
+
+void view_pop(View *view) {
+    assert(view->layers.len > 0);
+    layer_free(&view->layers.data[--view->layers.len]);
+    invalidate(view);
+}
+
+// The bytes held by `view`.
+size_t view_memory(const View *view) {
+    size_t bytes = view->rows.cap * sizeof(size_t);
+    for (size_t i = 0; i < view->layers.len; ++i)
+        bytes += view->layers.data[i].words * sizeof(uint64_t);
+    return bytes;
+}
+
+// Appends the rows in [start, end), which lie in a single block,
+// that every layer lets through. Whole words of every layer are
+// ANDed (or ANDNOTed) together, which the compiler vectorizes.
+static void combine(View *view, size_t start, size_t end) {
+    uint64_t acc[VIEW_BLOCK_WORDS];
+    size_t first = start / 64;
+    size_t n = (end + 63) / 64 - first;
+
+    for (size_t w = 0; w < n; ++w)
+        acc[w] = ~UINT64_C(0);
+    for (size_t i = 0; i < view->layers.len; ++i) {
+        const View_Layer *layer = &view->layers.data[i];
+        const uint64_t *bits = layer->bits + first;
+        uint64_t flip = layer->exclude ? ~UINT64_C(0) : 0;
+        for (size_t w = 0; w < n; ++w)
+            acc[w] &= bits[w] ^ flip;
+    }
+
+    acc[0] &= ~UINT64_C(0) << (start % 64);
+    if (end % 64)
+        acc[n - 1] &= (UINT64_C(1) << (end % 64)) - 1;
+
+    for (size_t w = 0; w < n; ++w) {
+        for (uint64_t word = acc[w]; word; word &= word - 1) {
+            size_t src = (first + w) * 64 + (size_t)__builtin_ctzll(word);
+            da_append(view->rows.data, view->rows.len, view->rows.cap, size_t *, src);
+        }
+    }
+}
+
+// Checks rows a block at a time until `row` rows pass or the
+// Line_Index runs out. Without `wait`, only rows that have already
+// been indexed are looked at. Returns whether `row` exists.
+static int extend(View *view, Line_Index *index, const char *data, size_t len, size_t row, int live, int wait) {
+    for (int first = 1; view->rows.len <= row; first = 0) {
+        if (view->interruptible && !first && input_pending())
+            return 0;
+
+        size_t start = view->checked;
+        size_t end = (start / VIEW_BLOCK_ROWS + 1) * VIEW_BLOCK_ROWS;
+        if (wait)
+            (void)line_index_has_row(index, data, len, end - 1, live);
+        if (end > line_index_rows(index))
+            end = line_index_rows(index);
+        if (end <= start)
+            return 0;
+
+        for (size_t i = 0; i < view->layers.len; ++i)
+            layer_fill(&view->layers.data[i], index, data, end);
+        combine(view, start, end);
+        view->checked = end;
+    }
+
+    return 1;
+}
+
+// Returns whether `row` exists in the view, checking (and
+// indexing, see line_index_has_row()) as many rows as that takes.
+int view_has_row(View *view, Line_Index *index, const char *data, size_t len, size_t row, int live) {
+    return extend(view, index, data, len, row, live, 1);
+}
+
+// Checks every row that has been indexed so far, without
+// waiting on the loader for more.
+void view_catch_up(View *view, Line_Index *index, const char *data) {
+    (void)extend(view, index, data, 0, SIZE_MAX, 0, 0);
+}
@@ -0,0 +1,80 @@
+#!/usr/bin/env python3
+# Runs bless --follow in a pty on a file that is then truncated and
+# rotated, and checks that it keeps showing the bottom of the file.
+#
+# usage: follow.py <path to bless>
+
+import fcntl
+import os
+import pty
+import select
+import shutil
+import signal
+import struct
+import sys
+import tempfile
+import termios
+import time
+
+WAIT = 1.0 # seconds to let it redraw
+
+def main():
+    bless = sys.argv[1]
+    tmp = tempfile.mkdtemp()
+    path = os.path.join(tmp, "log")
+    with open(path, "w") as f:
+        f.writelines("before %d\n" % i for i in range(100))
+
+    pid, fd = pty.fork()
+    if pid == 0:
+        os.execv(bless, [bless, "--follow", path])
+    fcntl.ioctl(fd, termios.TIOCSWINSZ, struct.pack("HHHH", 12, 60, 0, 0))
+
+    out = bytearray()
+
+    def pump():
+        end = time.time() + WAIT
+        while time.time() < end:
+            ready, _, _ = select.select([fd], [], [], 0.05)
+            if ready:
+                try:
+                    out.extend(os.read(fd, 65536))
+                except OSError:
+                    return
+
+    def append(lines):
+        with open(path, "a") as f:
+            f.writelines(line + "\n" for line in lines)
+
+    failed = []
+
+    def expect(what, text):
+        pump()
+        if text.encode() not in out:
+            failed.append(what)
+        out.clear()
+
+    pump()
+
+    open(path, "w").close()
+    append("truncated %d" % i for i in range(50))
+    expect("truncate", "truncated 49")
+    append(["after truncating"])
+    expect("append after truncate", "after truncating")
+
+    os.rename(path, path + ".1")
+    append("rotated %d" % i for i in range(30))
+    expect("rotate", "rotated 29")
+    append(["after rotating"])
+    expect("append after rotate", "after rotating")
+
+    os.kill(pid, signal.SIGKILL)
+    os.waitpid(pid, 0)
+    shutil.rmtree(tmp)
+
+    for what in failed:
+        print("FAIL: %s" % what)
+    return 1 if failed else 0
+
+if __name__ == "__main__":
+    sys.exit(main())